@@ -14,6 +14,7 @@
 #ifndef ABSTRACT_RNG_HPP_
 #define ABSTRACT_RNG_HPP_
 
+#include <cstddef>
 #include <phlib/cloneable.hpp>
 
 class AbstractRng : public phlib::Cloneable {
@@ -21,6 +22,16 @@ class AbstractRng : public phlib::Cloneable {
 	virtual double doGenerate() = 0;
 	virtual void doSeed(long seedValue) = 0;
 
+	/*
+	 * Generators override this to fill arrays without a virtual call per
+	 * value. The sequence must be the same as of repeated doGenerate().
+	 */
+	virtual void doGenerate(double values[], std::size_t const count) {
+		for (std::size_t i = 0; i < count; ++i) {
+			values[i] = doGenerate();
+		}
+	}
+
 public:
 
 	double operator()() {
@@ -31,6 +42,10 @@ public:
 		return doGenerate();
 	}
 
+	void generate(double values[], std::size_t const count) {
+		doGenerate(values, count);
+	}
+
 	void seed(long seedValue) {
 		doSeed(seedValue);
 	}
@@ -16,6 +16,7 @@
 
 #include <phlib/polymorphic.hpp>
 #include "../calc/network.hpp"
+#include "../calc/async_writer.hpp"
 
 class AbstractTracer : public phlib::Polymorphic {
 
@@ -25,6 +26,16 @@ class AbstractTracer : public phlib::Polymorphic {
 
 public:
 
+	AbstractTracer() : asyncWriter(NULL) {}
+
+	/*
+	 * Sets the writer records of the next run are passed to, or NULL
+	 * to write them synchronously.
+	 */
+	void setAsyncWriter(AsyncWriter* const writer) {
+		asyncWriter = writer;
+	}
+
 	void beforeRun(const Network& network, double const startTime, double const endTime, double const dt) {
 		doBeforeRun(network, startTime, endTime, dt);
 	}
@@ -37,6 +48,16 @@ public:
 		doAfterIteration(network, time);
 	}
 
+protected:
+
+	AsyncWriter* getAsyncWriter() const {
+		return asyncWriter;
+	}
+
+private:
+
+	AsyncWriter* asyncWriter;
+
 };
 
 #endif /* TRACER_ABSTRACT_TRACER_HPP_ */
@@ -0,0 +1,207 @@
+/*
+ * calc/async_writer.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_ASYNC_WRITER_HPP_
+#define CALC_ASYNC_WRITER_HPP_
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "spsc_queue.hpp"
+
+/*
+ * Passes trace records from the integration thread to a writer thread.
+ *
+ * The integration thread copies records into one of a fixed number of
+ * preallocated blocks, a full block is passed to the writer thread
+ * through a lock-free queue and comes back through another one when its
+ * records are stored. When all blocks wait for the writer the integration
+ * thread waits for one to come back, so memory stays bounded. Threads
+ * sleep on semaphores rather than spin while there is nothing to do.
+ *
+ * Sinks are attached before start(), records of all sinks are stored in
+ * the order they were written. stop() stores all pending records. If the
+ * thread cannot be started records are stored by the calling thread.
+ */
+class AsyncWriter {
+
+	struct Entry {
+		std::size_t block;
+		std::size_t size;
+	};
+
+	AsyncWriter(const AsyncWriter&);
+	AsyncWriter& operator=(const AsyncWriter&);
+
+public:
+
+	class Sink {
+	public:
+		virtual ~Sink() {}
+		virtual void store(double const time, const double values[]) = 0;
+	};
+
+	// doubles per block and number of blocks
+	static const std::size_t BLOCK_SIZE = 16384;
+	static const std::size_t NUM_OF_BLOCKS = 16;
+
+	AsyncWriter() :
+		blockSize(BLOCK_SIZE),
+		started(false),
+		current(0),
+		used(0),
+		filled(NUM_OF_BLOCKS + 1),
+		spare(NUM_OF_BLOCKS) {}
+
+	~AsyncWriter() {
+		stop();
+	}
+
+	unsigned attach(Sink& sink, std::size_t const numOfColumns) {
+		const SinkEntry entry = {&sink, numOfColumns};
+		sinks.push_back(entry);
+		blockSize = std::max(blockSize, numOfColumns + 2);
+		return sinks.size() - 1;
+	}
+
+	void start() {
+		if (started || sinks.empty()) {
+			return;
+		}
+
+		blocks.resize(NUM_OF_BLOCKS * blockSize);
+		for (std::size_t i = 0; i < NUM_OF_BLOCKS; ++i) {
+			spare.push(i);
+		}
+
+		sem_init(&filledCount, 0, 0);
+		sem_init(&spareCount, 0, NUM_OF_BLOCKS);
+
+		started = 0 == pthread_create(&thread, NULL, &run, this);
+		if (started) {
+			acquire();
+		} else {
+			sem_destroy(&filledCount);
+			sem_destroy(&spareCount);
+		}
+	}
+
+	void write(unsigned const sink, double const time, const double values[]) {
+		if (!started) {
+			sinks[sink].sink->store(time, values);
+			return;
+		}
+
+		const std::size_t numOfColumns = sinks[sink].numOfColumns;
+		if (used + numOfColumns + 2 > blockSize) {
+			submit(used);
+			acquire();
+		}
+
+		double* const p = &blocks[current * blockSize + used];
+		p[0] = sink;
+		p[1] = time;
+		std::memcpy(p + 2, values, numOfColumns * sizeof(double));
+		used += numOfColumns + 2;
+	}
+
+	void stop() {
+		if (!started) {
+			return;
+		}
+
+		submit(used);
+		// a block without size tells the writer to finish
+		submit(END);
+		pthread_join(thread, NULL);
+
+		sem_destroy(&filledCount);
+		sem_destroy(&spareCount);
+		started = false;
+	}
+
+private:
+
+	struct SinkEntry {
+		Sink* sink;
+		std::size_t numOfColumns;
+	};
+
+	static const std::size_t END = ~std::size_t(0);
+
+	std::vector<SinkEntry> sinks;
+	std::size_t blockSize;
+	std::vector<double> blocks;
+
+	bool started;
+	pthread_t thread;
+
+	// block being filled by the integration thread
+	std::size_t current;
+	std::size_t used;
+
+	SpscQueue<Entry> filled;
+	SpscQueue<std::size_t> spare;
+	sem_t filledCount;
+	sem_t spareCount;
+
+	static void wait(sem_t* const sem) {
+		while (0 != sem_wait(sem) && EINTR == errno) {}
+	}
+
+	void submit(std::size_t const size) {
+		const Entry entry = {current, size};
+		filled.push(entry);
+		sem_post(&filledCount);
+	}
+
+	void acquire() {
+		wait(&spareCount);
+		spare.pop(current);
+		used = 0;
+	}
+
+	void drain() {
+		for (;;) {
+			wait(&filledCount);
+
+			Entry entry;
+			filled.pop(entry);
+			if (END == entry.size) {
+				break;
+			}
+
+			const double* p = &blocks[entry.block * blockSize];
+			const double* const last = p + entry.size;
+			while (p < last) {
+				const SinkEntry& sink = sinks[static_cast<std::size_t>(p[0])];
+				sink.sink->store(p[1], p + 2);
+				p += sink.numOfColumns + 2;
+			}
+
+			spare.push(entry.block);
+			sem_post(&spareCount);
+		}
+	}
+
+	static void* run(void* arg) {
+		static_cast<AsyncWriter*>(arg)->drain();
+		return NULL;
+	}
+
+};
+
+#endif /* CALC_ASYNC_WRITER_HPP_ */
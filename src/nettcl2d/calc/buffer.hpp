@@ -0,0 +1,107 @@
+/*
+ * calc/buffer.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_BUFFER_HPP_
+#define CALC_BUFFER_HPP_
+
+#include <sys/mman.h>
+#include <cstddef>
+#include <new>
+
+/*
+ * Array of plain values in anonymous memory.
+ *
+ * Memory is not initialized on allocation, so a physical page is placed
+ * on the NUMA node of the thread which writes it first. Elements must be
+ * assigned before they are read. Large arrays may be backed by
+ * transparent huge pages.
+ */
+template <typename T>
+class Buffer {
+
+	// huge pages are not worth it for smaller arrays
+	static const std::size_t HUGE_PAGE_THRESHOLD = 4 * 1024 * 1024;
+
+	Buffer(const Buffer&);
+	Buffer& operator=(const Buffer&);
+
+public:
+
+	Buffer() : data(NULL), length(0) {}
+
+	~Buffer() {
+		release();
+	}
+
+	void allocate(std::size_t const size, bool const hugePages = false) {
+		release();
+		if (0 == size) {
+			return;
+		}
+
+		const std::size_t bytes = size * sizeof(T);
+		void* const p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == p) {
+			throw std::bad_alloc();
+		}
+
+#ifdef MADV_HUGEPAGE
+		if (hugePages && bytes >= HUGE_PAGE_THRESHOLD) {
+			madvise(p, bytes, MADV_HUGEPAGE);
+		}
+#endif
+
+		data = static_cast<T*>(p);
+		length = size;
+	}
+
+	void release() {
+		if (data) {
+			munmap(data, length * sizeof(T));
+			data = NULL;
+			length = 0;
+		}
+	}
+
+	std::size_t size() const {
+		return length;
+	}
+
+	bool empty() const {
+		return 0 == length;
+	}
+
+	T* get() {
+		return data;
+	}
+
+	const T* get() const {
+		return data;
+	}
+
+	T& operator[](std::size_t const i) {
+		return data[i];
+	}
+
+	const T& operator[](std::size_t const i) const {
+		return data[i];
+	}
+
+private:
+
+	T* data;
+	std::size_t length;
+
+};
+
+#endif /* CALC_BUFFER_HPP_ */
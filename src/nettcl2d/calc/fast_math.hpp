@@ -0,0 +1,136 @@
+/*
+ * calc/fast_math.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_FAST_MATH_HPP_
+#define CALC_FAST_MATH_HPP_
+
+#include <cmath>
+
+/*
+ * Sine and cosine of selectable accuracy.
+ *
+ * Every flavour is a class with static template functions sin() and cos()
+ * of float or double argument, so it can be passed to templates as a
+ * policy. Polynomial flavours reduce the argument to [-pi, pi] and then
+ * to [-pi/2, pi/2] where an odd minimax polynomial is evaluated. The code
+ * has no branches the compiler cannot turn into selects, so loops calling
+ * it may be vectorized. Reduction costs little when the argument is
+ * already close to [-pi, pi), e.g. a wrapped phase.
+ */
+namespace fast_math {
+
+	enum Accuracy {
+		ACCURACY_FULL,
+		ACCURACY_1E10,
+		ACCURACY_1E6
+	};
+
+	/*
+	 * Functions of the C library.
+	 */
+	struct Libm {
+
+		template <typename T>
+		static T sin(T const x) {
+			return std::sin(x);
+		}
+
+		template <typename T>
+		static T cos(T const x) {
+			return std::cos(x);
+		}
+
+	};
+
+	/*
+	 * Sine on [-pi/2, pi/2] with absolute error below 6e-7.
+	 */
+	struct Minimax7 {
+
+		template <typename T>
+		static T eval(T const x) {
+			const T x2 = x * x;
+			return x * (T(0.99999661590814415)
+				+ x2 * (T(-0.16664828381945471)
+				+ x2 * (T(0.0083063252275838162)
+				+ x2 * T(-0.00018363653986658201))));
+		}
+
+	};
+
+	/*
+	 * Sine on [-pi/2, pi/2] with absolute error below 1.4e-11.
+	 */
+	struct Minimax11 {
+
+		template <typename T>
+		static T eval(T const x) {
+			const T x2 = x * x;
+			return x * (T(0.99999999988985178)
+				+ x2 * (T(-0.16666666541439151)
+				+ x2 * (T(0.0083333292644578692)
+				+ x2 * (T(-0.00019840702862737898)
+				+ x2 * (T(2.751885564582156e-06)
+				+ x2 * T(-2.3794713667522836e-08))))));
+		}
+
+	};
+
+	template <typename Minimax>
+	struct Poly {
+
+		template <typename T>
+		static T sin(T const x) {
+			const T r = reduce(x);
+			const T halfPi = T(1.5707963267948966192313216916398);
+			const T pi = T(3.1415926535897932384626433832795);
+
+			// sin(x) = sin(pi - x) = sin(-pi - x)
+			return Minimax::eval(r > halfPi ? pi - r : (r < -halfPi ? -pi - r : r));
+		}
+
+		template <typename T>
+		static T cos(T const x) {
+			const T halfPi = T(1.5707963267948966192313216916398);
+
+			// cos(x) = sin(pi/2 - |x|)
+			return Minimax::eval(halfPi - std::fabs(reduce(x)));
+		}
+
+	private:
+
+		/*
+		 * Subtracts the nearest multiple of 2 pi (Cody and Waite). The
+		 * constant is split in three parts, the first two have 8 and 24
+		 * significant bits, so their products by n are exact while n is
+		 * below 2^29 and only the last, tiny one is rounded.
+		 */
+		template <typename T>
+		static T reduce(T const x) {
+			const double twoPi1 = 6.28125;
+			const double twoPi2 = 0.00193530716933310031890869140625;
+			const double twoPi3 = 1.0253376606378076e-11;
+			const double invTwoPi = 0.15915494309189533577;
+
+			const double n = std::floor(x * invTwoPi + 0.5);
+			return T(((x - n * twoPi1) - n * twoPi2) - n * twoPi3);
+		}
+
+	};
+
+	typedef Poly<Minimax11> Poly1e10;
+	typedef Poly<Minimax7> Poly1e6;
+
+}
+
+#endif /* CALC_FAST_MATH_HPP_ */
@@ -0,0 +1,120 @@
+/*
+ * calc/flux_map.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_FLUX_MAP_HPP_
+#define CALC_FLUX_MAP_HPP_
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "network.hpp"
+
+/*
+ * Circuit fluxes arranged by the circuits' x and y properties.
+ *
+ * The map covers the bounding box of all circuits having numeric x and y,
+ * values are stored row by row, y is the outer index. A cell without a
+ * circuit, or with more than one, holds zero.
+ */
+class FluxMap {
+public:
+
+	explicit FluxMap(const Network& network) :
+		minX(0), maxX(-1), minY(0), maxY(-1) {
+
+		const PropTable& props = network.getCircuitProps();
+		const PropTable::column_id xId = props.findColumn("x");
+		const PropTable::column_id yId = props.findColumn("y");
+		const std::size_t numOfCircuits = network.getNumOfCircuits();
+
+		std::vector<long> xs(numOfCircuits), ys(numOfCircuits);
+		std::vector<bool> placed(numOfCircuits, false);
+
+		for (std::size_t i = 0; i < numOfCircuits; ++i) {
+			double x, y;
+			if (props.getNumber(i, xId, x) && props.getNumber(i, yId, y)) {
+				xs[i] = std::floor(x + 0.5);
+				ys[i] = std::floor(y + 0.5);
+				if (isEmpty()) {
+					minX = maxX = xs[i];
+					minY = maxY = ys[i];
+				} else {
+					minX = std::min(minX, xs[i]);
+					maxX = std::max(maxX, xs[i]);
+					minY = std::min(minY, ys[i]);
+					maxY = std::max(maxY, ys[i]);
+				}
+				placed[i] = true;
+			}
+		}
+
+		values.assign(getNumOfColumns() * getNumOfRows(), 0.0);
+		std::vector<bool> occupied(values.size(), false);
+
+		for (std::size_t i = 0; i < numOfCircuits; ++i) {
+			if (placed[i]) {
+				const std::size_t cell = offset(xs[i], ys[i]);
+				values[cell] = occupied[cell] ? 0.0 : network.flux(i);
+				occupied[cell] = true;
+			}
+		}
+	}
+
+	bool isEmpty() const {
+		return maxX < minX;
+	}
+
+	long getMinX() const {
+		return minX;
+	}
+
+	long getMaxX() const {
+		return maxX;
+	}
+
+	long getMinY() const {
+		return minY;
+	}
+
+	long getMaxY() const {
+		return maxY;
+	}
+
+	std::size_t getNumOfColumns() const {
+		return isEmpty() ? 0 : maxX - minX + 1;
+	}
+
+	std::size_t getNumOfRows() const {
+		return isEmpty() ? 0 : maxY - minY + 1;
+	}
+
+	double operator()(long const x, long const y) const {
+		return values[offset(x, y)];
+	}
+
+	const std::vector<double>& getValues() const {
+		return values;
+	}
+
+private:
+
+	long minX, maxX, minY, maxY;
+	std::vector<double> values;
+
+	std::size_t offset(long const x, long const y) const {
+		return (y - minY) * getNumOfColumns() + (x - minX);
+	}
+
+};
+
+#endif /* CALC_FLUX_MAP_HPP_ */
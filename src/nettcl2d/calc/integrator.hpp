@@ -16,6 +16,7 @@
 
 #include <stdexcept>
 #include <vector>
+#include <boost/scoped_ptr.hpp>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_odeiv.h>
@@ -23,6 +24,11 @@
 #include "network.hpp"
 #include "abstract_tracer.hpp"
 #include "abstract_perturbator.hpp"
+#include "kernel.hpp"
+#include "process_group.hpp"
+#include "thread_group.hpp"
+#include "buffer.hpp"
+#include "async_writer.hpp"
 
 class Integrator : public phlib::Cloneable {
 
@@ -43,15 +49,6 @@ class Integrator : public phlib::Cloneable {
 
 	};
 
-	struct CircuitRef {
-		int index;
-		double gain;
-
-		CircuitRef() : index(-1) {}
-	};
-	typedef std::pair<CircuitRef, CircuitRef> CircuitRefPair;
-	typedef std::vector<CircuitRefPair> CircuitRefPairVector;
-
 	Integrator(const Integrator& src) : params(src.params) {}
 
 	virtual phlib::Cloneable* doClone() const {
@@ -60,53 +57,58 @@ class Integrator : public phlib::Cloneable {
 
 public:
 
+	typedef std::vector<int> AffinityVector;
+
+	enum Precision {
+		PRECISION_DOUBLE,
+		PRECISION_SINGLE
+	};
+
 	struct Params {
 		double step;
 		double delta;
+		unsigned tileSize;
+		KernelLayout::Ordering ordering;
+		unsigned processes;
+		KernelLayout::Partitioning partitioning;
+		unsigned threads;
+		AffinityVector affinity;
+		bool hugePages;
+		Precision precision;
+		fast_math::Accuracy sinAccuracy;
+		bool asyncTracing;
 
 		Params() :
 			step(1.0e-6),
-			delta(1.0e-6)
+			delta(1.0e-6),
+			tileSize(4096),
+			ordering(KernelLayout::ORDERING_RCM),
+			processes(1),
+			partitioning(KernelLayout::PARTITIONING_STRIPS),
+			threads(1),
+			hugePages(false),
+			precision(PRECISION_DOUBLE),
+			sinAccuracy(fast_math::ACCURACY_FULL),
+			asyncTracing(false)
 		{}
 	};
 
 	Integrator(const Params& params) : params(params) {}
 
 	void run(Network& network, double const startTime, double const endTime, double const dt) {
-		const static int numOfEqs = network.getNumOfContacts() * 2;
-		this->network = &network;
-		gsl_odeiv_step* s = gsl_odeiv_step_alloc(gsl_odeiv_step_rkf45, numOfEqs);
-		gsl_odeiv_control* c = gsl_odeiv_control_y_new(params.delta, 0.0);
-		gsl_odeiv_evolve* e = gsl_odeiv_evolve_alloc(numOfEqs);
-		gsl_odeiv_system sys = {&solver, NULL, numOfEqs, this};
-
-		beforeRun(network, startTime, endTime, dt);
-
-		buildCircuitRefs();
-		y.resize(numOfEqs);
-		getYValues(network);
-
-		unsigned long timeSteps = 1;
-		for (double time = startTime; time <= endTime; ++timeSteps) {
-			double h = params.step;
-			double t = time;
+		if (params.threads > 1 && params.processes > 1) {
+			throw std::invalid_argument("threads and processes cannot be used together");
+		}
 
-			time = startTime + timeSteps * dt;
+		// worker threads read the network, so storage shared with copies
+		// must not be replaced in the middle of the run
+		network.detach();
 
-			// start integration loop
-			while (t < time) {
-				const int status = ::gsl_odeiv_evolve_apply(e, c, s, &sys, &t, time, &h, &y[0]);
-				if (status != GSL_SUCCESS) {
-					throw IntegrationError(status);
-				}
-			}
-			// integration completed
-
-			setYValues(network);
-			afterIteration(network, time);
+		if (PRECISION_SINGLE == params.precision) {
+			runWith<float>(network, startTime, endTime, dt);
+		} else {
+			runWith<double>(network, startTime, endTime, dt);
 		}
-
-		afterRun(network);
 	}
 
 	void addTracer(AbstractTracer& tracer) {
@@ -134,10 +136,6 @@ private:
 	Params params;
 	TracerVector tracers;
 	PerturbatorVector perturbators;
-	std::vector<double> y;
-	Network* network;
-	CircuitRefPairVector circuitRefs;
-	std::vector<double> circuitPhases;
 
 	void beforeRun(Network& network, double const startTime, double const endTime, double const dt) {
 		for (PerturbatorVector::iterator i = perturbators.begin(), last = perturbators.end(); i != last; ++i) {
@@ -159,107 +157,188 @@ private:
 		}
 	}
 
+	void setAsyncWriter(AsyncWriter* const writer) {
+		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
+			(*i)->setAsyncWriter(writer);
+		}
+	}
+
 	void afterIteration(const Network& network, double const time) {
 		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
 			(*i)->afterIteration(network, time);
 		}
 	}
 
-	void getYValues(const Network& network) {
-		std::vector<double>::iterator i = y.begin();
-		for (Network::contact_const_iterator c = network.contactBegin(), last = network.contactEnd(); c != last; ++c) {
-			*i++ = c->phase;
-			*i++ = c->voltage;
+	/*
+	 * Binds the network to the integrator state for the time of a run.
+	 * The state is written back to network contacts on release.
+	 */
+	class StateBinding {
+
+		StateBinding(const StateBinding&);
+		StateBinding& operator=(const StateBinding&);
+
+	public:
+
+		StateBinding(Network& network, const KernelLayout& kernel, const double y[]) :
+			network(&network), kernel(kernel), y(y), view(kernel.getStateView(y)) {
+
+			network.bindState(&view);
 		}
-	}
 
-	void setYValues(Network& network) {
-		std::vector<double>::const_iterator i = y.begin();
-		for (Network::contact_iterator c = network.contactBegin(), last = network.contactEnd(); c != last; ++c) {
-			c->phase = *i++;
-			c->voltage = *i++;
+		~StateBinding() {
+			release();
 		}
-	}
 
-	static int solver(const double t, const double y[], double f[], void* params) {
-		return reinterpret_cast<Integrator*>(params)->solverImpl(t, y, f);
-	}
+		void release() {
+			if (network) {
+				network->bindState(NULL);
+				kernel.store(y, *network);
+				network = NULL;
+			}
+		}
+
+	private:
+
+		Network* network;
+		const KernelLayout& kernel;
+		const double* y;
+		const StateView view;
 
-	int solverImpl(const double t, const double y[], double f[]) {
-		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
-
-		buildCircuitPhases();
-
-		int i = 0;
-		CircuitRefPairVector::const_iterator ref = circuitRefs.begin();
-		for (
-				Network::contact_const_iterator c = network->contactBegin(), end = network->contactEnd();
-				c != end;
-				++c, ++ref, i += 2) {
-			/*
-			 * y[i]    : phi(t)
-			 * y[i + 1]: u(t)
-			 * f[i]    : d(phi)/dt
-			 * f[i + 1]: d(u)/dt
-			 */
-			f[i] = y[i + 1];
-			f[i + 1] = 1.0 / c->beta * (
-				twoPi * c->z
-				+ calcCircuits(*ref)
-				- c->tau * y[i + 1]
-				- c->v * sin(y[i])
-			);
+	};
+
+	/*
+	 * Right-hand side of the ODE system evaluated by the kernel directly
+	 * or by a group of threads or processes. A failure of the process
+	 * group is not thrown through GSL, it is kept in error and the
+	 * evaluation fails.
+	 */
+	template <typename KernelType>
+	struct Solver {
+		KernelType* kernel;
+		ThreadGroup<KernelType>* threads;
+		ProcessGroup<KernelType>* processes;
+		std::string error;
+
+		static int function(const double /* t */, const double y[], double f[], void* params) {
+			Solver* const solver = reinterpret_cast<Solver*>(params);
+
+			if (solver->threads) {
+				solver->threads->evaluate(y, f);
+			} else if (solver->processes) {
+				try {
+					solver->processes->evaluate(y, f);
+				} catch (typename ProcessGroup<KernelType>::ProcessError& ex) {
+					solver->error = ex.what();
+					return GSL_EFAILED;
+				}
+			} else {
+				solver->kernel->evaluate(y, f);
+			}
+			return GSL_SUCCESS;
 		}
 
-		return GSL_SUCCESS;
-	}
+		void wrap(double y[]) {
+			if (threads) {
+				threads->wrap(y);
+			} else if (processes) {
+				processes->wrap(y);
+			} else {
+				kernel->wrap(y);
+			}
+		}
+	};
 
-	double calcCircuits(const CircuitRefPair& refs) const {
-		return calcCircuit(refs.first) + calcCircuit(refs.second);
+	template <typename Scalar>
+	void runWith(Network& network, double const startTime, double const endTime, double const dt) {
+		switch (params.sinAccuracy) {
+		case fast_math::ACCURACY_1E10:
+			runKernel<Kernel<Scalar, fast_math::Poly1e10> >(network, startTime, endTime, dt);
+			break;
+
+		case fast_math::ACCURACY_1E6:
+			runKernel<Kernel<Scalar, fast_math::Poly1e6> >(network, startTime, endTime, dt);
+			break;
+
+		default:
+			runKernel<Kernel<Scalar> >(network, startTime, endTime, dt);
+		}
 	}
 
-	double calcCircuit(const CircuitRef& ref) const {
-		if (ref.index < 0) {
-			return 0.0;
+	template <typename KernelType>
+	void runKernel(Network& network, double const startTime, double const endTime, double const dt) {
+		const int numOfEqs = network.getNumOfContacts() * 2;
+		gsl_odeiv_step* s = gsl_odeiv_step_alloc(gsl_odeiv_step_rkf45, numOfEqs);
+		gsl_odeiv_control* c = gsl_odeiv_control_y_new(params.delta, 0.0);
+		gsl_odeiv_evolve* e = gsl_odeiv_evolve_alloc(numOfEqs);
+
+		// tracers attach their files to the writer before it starts
+		boost::scoped_ptr<AsyncWriter> writer(params.asyncTracing ? new AsyncWriter() : NULL);
+		setAsyncWriter(writer.get());
+		beforeRun(network, startTime, endTime, dt);
+
+		// with threads every part is filled by its own thread
+		KernelType kernel;
+		Buffer<double> y;
+		const unsigned numOfParts = std::max(params.threads, params.processes);
+		kernel.prepare(network, params.tileSize, params.ordering, numOfParts, params.partitioning, params.hugePages);
+		y.allocate(numOfEqs, params.hugePages);
+
+		boost::scoped_ptr<ThreadGroup<KernelType> > threads;
+		if (params.threads > 1) {
+			threads.reset(new ThreadGroup<KernelType>(kernel, network, y.get(), params.affinity));
+		} else {
+			kernel.fill(network);
+			kernel.load(network, y.get());
 		}
 
-		return circuitPhases[ref.index] * ref.gain;
-	}
+		boost::scoped_ptr<ProcessGroup<KernelType> > processes(
+				params.processes > 1 ? new ProcessGroup<KernelType>(kernel) : NULL);
 
-	void buildCircuitRefs() {
-		circuitRefs.clear();
-		circuitRefs.resize(network->getNumOfContacts());
+		Solver<KernelType> solver = {&kernel, threads.get(), processes.get()};
+		gsl_odeiv_system sys = {&Solver<KernelType>::function, NULL, numOfEqs, &solver};
+		StateBinding binding(network, kernel, y.get());
 
-		for (
-				Network::circuit_const_iterator first = network->circuitBegin(), circuit = first, end = network->circuitEnd();
-				circuit != end;
-				++circuit) {
+		// the writer thread starts after worker processes are forked
+		if (writer) {
+			writer->start();
+		}
 
-			for (Circuit::const_iterator ci = circuit->begin(), last = circuit->end(); ci != last; ++ci) {
-				CircuitRefPair& pair = circuitRefs[ci->index];
-				CircuitRef& ref = pair.first.index < 0 ? pair.first : pair.second;
-				ref.index = std::distance(first, circuit);
-				ref.gain = ci->gain;
+		unsigned long timeSteps = 1;
+		for (double time = startTime; time <= endTime; ++timeSteps) {
+			double h = params.step;
+			double t = time;
+
+			time = startTime + timeSteps * dt;
+
+			// start integration loop
+			while (t < time) {
+				const int status = ::gsl_odeiv_evolve_apply(e, c, s, &sys, &t, time, &h, y.get());
+				if (!solver.error.empty()) {
+					throw typename ProcessGroup<KernelType>::ProcessError(solver.error);
+				}
+				if (status != GSL_SUCCESS) {
+					throw IntegrationError(status);
+				}
+				solver.wrap(y.get());
 			}
+			// integration completed
+
+			afterIteration(network, time);
 		}
-	}
 
-	void buildCircuitPhases() {
-		circuitPhases.resize(network->getNumOfCircuits());
-		std::vector<double>::iterator dest = circuitPhases.begin();
-		for (
-				Network::circuit_const_iterator first = network->circuitBegin(), circuit = first, end = network->circuitEnd();
-				circuit != end;
-				++circuit, ++dest) {
-
-			double sum = 0.0;
-			for (Circuit::const_iterator ci = circuit->begin(), last = circuit->end(); ci != last; ++ci) {
-				const Contact& contact = network->contact(ci->index);
-				sum += contact.phase * ci->weight;
-			}
-			*dest = sum * circuit->square;
+		binding.release();
+		processes.reset();
+		threads.reset();
+
+		// pending records are stored before tracers close their files
+		if (writer) {
+			writer->stop();
 		}
+		afterRun(network);
+		setAsyncWriter(NULL);
 	}
+
 };
 
 
@@ -0,0 +1,553 @@
+/*
+ * calc/kernel.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_KERNEL_HPP_
+#define CALC_KERNEL_HPP_
+
+#include <cmath>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include "network.hpp"
+#include "buffer.hpp"
+#include "state_view.hpp"
+#include "fast_math.hpp"
+#include "ordering.hpp"
+#include "partitioner.hpp"
+
+/*
+ * Layout of the network ODE system: order of contacts, tiles, parts and
+ * circuit schedule. It does not depend on the scalar type of a kernel.
+ *
+ * Contacts are stored in slots which may be permuted to improve locality,
+ * circuits are stored in the order tiles need them. The permutation is
+ * internal: load() and store() exchange state with the network by contact
+ * index.
+ *
+ * For parallel evaluation slots are grouped into parts of consecutive
+ * tiles, either equal strips of the ordered contacts or parts found by
+ * graph partitioning. Every circuit belongs to the first part referring
+ * to it.
+ *
+ * Contact phases in the state are kept in [-pi, pi), every slot has a
+ * winding number counting the whole turns removed from its phase. The
+ * unwrapped phase is y[2 * slot] + 2 * pi * winding[slot], store()
+ * writes it back to the network.
+ */
+class KernelLayout {
+public:
+
+	enum Ordering {
+		ORDERING_NONE,
+		ORDERING_RCM
+	};
+
+	enum Partitioning {
+		PARTITIONING_STRIPS,
+		PARTITIONING_GRAPH
+	};
+
+	struct Tile {
+		std::size_t contactBegin, contactEnd;
+		std::size_t circuitBegin, circuitEnd;
+
+		Tile(std::size_t const contactBegin, std::size_t const circuitBegin) :
+			contactBegin(contactBegin), contactEnd(contactBegin),
+			circuitBegin(circuitBegin), circuitEnd(circuitBegin) {}
+	};
+	typedef std::vector<Tile> TileVector;
+
+	struct Part {
+		std::size_t tileBegin, tileEnd;
+		std::size_t contactBegin, contactEnd;
+		std::size_t circuitBegin, circuitEnd;
+
+		Part(std::size_t const tileBegin, std::size_t const contactBegin, std::size_t const circuitBegin) :
+			tileBegin(tileBegin), tileEnd(tileBegin),
+			contactBegin(contactBegin), contactEnd(contactBegin),
+			circuitBegin(circuitBegin), circuitEnd(circuitBegin) {}
+	};
+	typedef std::vector<Part> PartVector;
+
+	void load(const Network& network, double y[]) {
+		for (std::size_t p = 0; p < parts.size(); ++p) {
+			loadPart(network, y, p);
+		}
+	}
+
+	void loadPart(const Network& network, double y[], std::size_t const p) {
+		for (std::size_t slot = parts[p].contactBegin, last = parts[p].contactEnd; slot < last; ++slot) {
+			const Contact& c = network.contact(contactAt[slot]);
+			y[2 * slot] = c.phase;
+			y[2 * slot + 1] = c.voltage;
+			winding[slot] = 0;
+			wrapPhase(y[2 * slot], winding[slot]);
+		}
+	}
+
+	void store(const double y[], Network& network) const {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+
+		for (std::size_t slot = 0, last = contactAt.size(); slot < last; ++slot) {
+			Contact& c = network.contact(contactAt[slot]);
+			c.phase = y[2 * slot] + twoPi * winding[slot];
+			c.voltage = y[2 * slot + 1];
+		}
+	}
+
+	/*
+	 * Brings phases of the state back to [-pi, pi) updating winding
+	 * numbers. Returns true if any winding number has changed.
+	 */
+	bool wrap(double y[]) {
+		bool changed = false;
+		for (std::size_t p = 0; p < parts.size(); ++p) {
+			changed = wrapPart(y, p) || changed;
+		}
+		return changed;
+	}
+
+	bool wrapPart(double y[], std::size_t const p) {
+		bool changed = false;
+		for (std::size_t slot = parts[p].contactBegin, last = parts[p].contactEnd; slot < last; ++slot) {
+			changed = wrapPhase(y[2 * slot], winding[slot]) || changed;
+		}
+		return changed;
+	}
+
+	const long* getWinding() const {
+		return winding.empty() ? NULL : winding.get();
+	}
+
+	StateView getStateView(const double y[]) const {
+		return StateView(y, getWinding(), slots.empty() ? NULL : &slots[0]);
+	}
+
+	const TileVector& getTiles() const {
+		return tiles;
+	}
+
+	const PartVector& getParts() const {
+		return parts;
+	}
+
+	std::size_t getNumOfEquations() const {
+		return 2 * contactAt.size();
+	}
+
+	std::size_t getNumOfCircuits() const {
+		return schedule.size();
+	}
+
+protected:
+
+	struct CircuitRef {
+		int index;
+		double gain;
+
+		CircuitRef() : index(-1) {}
+	};
+	typedef std::pair<CircuitRef, CircuitRef> CircuitRefPair;
+	typedef std::vector<CircuitRefPair> CircuitRefPairVector;
+
+	// slot -> contact index
+	Network::IndexVector contactAt;
+	// contact index -> slot
+	Network::IndexVector slots;
+	// first slot of every part and the end of the last one
+	std::vector<std::size_t> partBounds;
+
+	// circuit references by slot and bounds of circuit contact refs,
+	// needed until working arrays are filled
+	CircuitRefPairVector refsBySlot;
+	std::vector<std::size_t> refBounds;
+
+	// schedule position -> network circuit index
+	std::vector<std::size_t> schedule;
+	TileVector tiles;
+	PartVector parts;
+
+	// whole turns removed from phases by slot
+	Buffer<long> winding;
+
+	KernelLayout() {}
+
+	void buildLayout(
+			const Network& network,
+			std::size_t const tileSize,
+			Ordering const ordering,
+			unsigned const numOfParts,
+			Partitioning const partitioning) {
+
+		buildSlots(network, ordering, std::max(1u, numOfParts), partitioning);
+		buildCircuitRefs(network);
+		buildTiles(network, tileSize);
+		buildCircuitBounds(network);
+	}
+
+	void releaseLayout() {
+		CircuitRefPairVector().swap(refsBySlot);
+		std::vector<std::size_t>().swap(refBounds);
+	}
+
+private:
+
+	KernelLayout(const KernelLayout&);
+	KernelLayout& operator=(const KernelLayout&);
+
+	static bool wrapPhase(double& phase, long& turns) {
+		const static double pi = 3.1415926535897932384626433832795;
+
+		if (phase < -pi || phase >= pi) {
+			const double n = std::floor((phase + pi) / (2.0 * pi));
+			phase -= n * 2.0 * pi;
+			turns += static_cast<long>(n);
+			return true;
+		}
+
+		return false;
+	}
+
+	void buildSlots(const Network& network, Ordering const ordering, unsigned const numOfParts, Partitioning const partitioning) {
+		contactAt = ORDERING_RCM == ordering ? ordering::reverseCuthillMcKee(network) : ordering::identity(network);
+		const std::size_t numOfContacts = contactAt.size();
+
+		partBounds.assign(numOfParts + 1, 0);
+		if (PARTITIONING_GRAPH == partitioning && numOfParts > 1) {
+			// group contacts by part keeping their order inside a part
+			const partitioner::PartVector part = partitioner::partition(network, numOfParts);
+
+			for (std::size_t i = 0; i < numOfContacts; ++i) {
+				++partBounds[part[i] + 1];
+			}
+			for (unsigned p = 0; p < numOfParts; ++p) {
+				partBounds[p + 1] += partBounds[p];
+			}
+
+			std::vector<std::size_t> next(partBounds.begin(), partBounds.end() - 1);
+			Network::IndexVector grouped(numOfContacts);
+			for (std::size_t slot = 0; slot < numOfContacts; ++slot) {
+				grouped[next[part[contactAt[slot]]]++] = contactAt[slot];
+			}
+			contactAt.swap(grouped);
+		} else {
+			for (unsigned p = 0; p <= numOfParts; ++p) {
+				partBounds[p] = numOfContacts * p / numOfParts;
+			}
+		}
+
+		slots.resize(numOfContacts);
+		for (std::size_t slot = 0; slot < numOfContacts; ++slot) {
+			slots[contactAt[slot]] = slot;
+		}
+	}
+
+	/*
+	 * Collects references to network circuits by slot, they are replaced
+	 * by schedule positions in buildTiles().
+	 */
+	void buildCircuitRefs(const Network& network) {
+		refsBySlot.clear();
+		refsBySlot.resize(contactAt.size());
+
+		for (
+				Network::circuit_const_iterator first = network.circuitBegin(), circuit = first, end = network.circuitEnd();
+				circuit != end;
+				++circuit) {
+
+			for (Circuit::const_iterator ci = circuit->begin(), last = circuit->end(); ci != last; ++ci) {
+				CircuitRefPair& pair = refsBySlot[slots[ci->index]];
+				CircuitRef& ref = pair.first.index < 0 ? pair.first : pair.second;
+				ref.index = std::distance(first, circuit);
+				ref.gain = ci->gain;
+			}
+		}
+	}
+
+	/*
+	 * Splits slots of every part into tiles of tileSize elements (0 means
+	 * a single tile per part) and assigns every circuit to the first tile
+	 * referring to it.
+	 */
+	void buildTiles(const Network& network, std::size_t const tileSize) {
+		std::vector<int> position(network.getNumOfCircuits(), -1);
+
+		tiles.clear();
+		parts.clear();
+		schedule.clear();
+
+		for (std::size_t p = 0; p + 1 < partBounds.size(); ++p) {
+			const std::size_t partEnd = partBounds[p + 1];
+			const std::size_t step = tileSize > 0 ? tileSize : partEnd - partBounds[p];
+			Part part(tiles.size(), partBounds[p], schedule.size());
+
+			for (std::size_t begin = partBounds[p]; begin < partEnd; begin += step) {
+				Tile tile(begin, schedule.size());
+				tile.contactEnd = std::min(begin + step, partEnd);
+
+				for (std::size_t n = tile.contactBegin; n != tile.contactEnd; ++n) {
+					scheduleCircuit(refsBySlot[n].first, position);
+					scheduleCircuit(refsBySlot[n].second, position);
+				}
+
+				tile.circuitEnd = schedule.size();
+				tiles.push_back(tile);
+			}
+
+			part.tileEnd = tiles.size();
+			part.contactEnd = partEnd;
+			part.circuitEnd = schedule.size();
+			parts.push_back(part);
+		}
+	}
+
+	void scheduleCircuit(CircuitRef& ref, std::vector<int>& position) {
+		if (ref.index >= 0) {
+			if (position[ref.index] < 0) {
+				position[ref.index] = schedule.size();
+				schedule.push_back(ref.index);
+			}
+			ref.index = position[ref.index];
+		}
+	}
+
+	void buildCircuitBounds(const Network& network) {
+		const std::size_t numOfCircuits = schedule.size();
+
+		refBounds.resize(numOfCircuits + 1);
+		refBounds[0] = 0;
+		for (std::size_t k = 0; k < numOfCircuits; ++k) {
+			refBounds[k + 1] = refBounds[k] + network.circuit(schedule[k]).contactRefs.size();
+		}
+	}
+
+};
+
+/*
+ * Evaluates right-hand side of the network ODE system.
+ *
+ * Contacts are processed by tiles of consecutive slots. For every tile
+ * the phases of circuits its contacts depend on are calculated first and
+ * then the contact derivatives, so both passes work on data that is still
+ * in cache. A circuit on the edge of two tiles is calculated once by the
+ * first tile needing it, the next tile reuses the stored phase.
+ *
+ * Contact parameters, circuit structure and circuit phases are stored in
+ * working arrays of the Scalar type. The state is always double since the
+ * solver works in double; circuit sums are accumulated in double as well
+ * from unwrapped contact phases, while the sine takes the wrapped one.
+ * The sine is calculated by the Trig policy, see fast_math.hpp.
+ * Working arrays of a part are contiguous and may be filled by the thread
+ * evaluating the part, see prepare() and initPart().
+ */
+template <typename Scalar, typename Trig = fast_math::Libm>
+class Kernel : public KernelLayout {
+
+	struct ScalarRef {
+		int index;
+		Scalar gain;
+	};
+	typedef std::pair<ScalarRef, ScalarRef> ScalarRefPair;
+
+public:
+
+	typedef Scalar scalar_type;
+
+	Kernel() {}
+
+	void build(
+			const Network& network,
+			std::size_t const tileSize,
+			Ordering const ordering,
+			unsigned const numOfParts,
+			Partitioning const partitioning,
+			bool const hugePages = false) {
+
+		prepare(network, tileSize, ordering, numOfParts, partitioning, hugePages);
+		fill(network);
+	}
+
+	/*
+	 * Builds the layout and allocates working arrays without filling them.
+	 * Every part must be filled by initPart() and then finish() called.
+	 */
+	void prepare(
+			const Network& network,
+			std::size_t const tileSize,
+			Ordering const ordering,
+			unsigned const numOfParts,
+			Partitioning const partitioning,
+			bool const hugePages) {
+
+		buildLayout(network, tileSize, ordering, numOfParts, partitioning);
+		allocate(hugePages);
+	}
+
+	/*
+	 * Fills working arrays of a part. Different parts may be filled by
+	 * different threads concurrently.
+	 */
+	void initPart(const Network& network, std::size_t const p) {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+		const Part& part = parts[p];
+
+		for (std::size_t slot = part.contactBegin; slot != part.contactEnd; ++slot) {
+			const Contact& c = network.contact(contactAt[slot]);
+			invBeta[slot] = 1.0 / c.beta;
+			tau[slot] = c.tau;
+			v[slot] = c.v;
+			twoPiZ[slot] = twoPi * c.z;
+			circuitRefs[slot] = ScalarRefPair(convert(refsBySlot[slot].first), convert(refsBySlot[slot].second));
+		}
+
+		for (std::size_t k = part.circuitBegin; k != part.circuitEnd; ++k) {
+			const Circuit& circuit = network.circuit(schedule[k]);
+			std::size_t r = refBounds[k];
+
+			refStart[k] = r;
+			for (Circuit::const_iterator ci = circuit.begin(), last = circuit.end(); ci != last; ++ci, ++r) {
+				refSlot[r] = slots[ci->index];
+				refWeight[r] = ci->weight;
+			}
+
+			square[k] = circuit.square;
+			circuitPhases[k] = 0;
+		}
+	}
+
+	/*
+	 * Fills all parts by the calling thread.
+	 */
+	void fill(const Network& network) {
+		for (std::size_t p = 0; p < parts.size(); ++p) {
+			initPart(network, p);
+		}
+		finish();
+	}
+
+	/*
+	 * Releases temporary data of prepare() once all parts are filled.
+	 */
+	void finish() {
+		refStart[schedule.size()] = refBounds.back();
+		releaseLayout();
+	}
+
+	void evaluate(const double y[], double f[]) {
+		const long* const turns = getWinding();
+		Scalar* const phases = getCircuitPhases();
+
+		for (TileVector::const_iterator tile = tiles.begin(), last = tiles.end(); tile != last; ++tile) {
+			evaluateCircuits(*tile, y, turns, phases);
+			evaluateContacts(*tile, y, phases, f);
+		}
+	}
+
+	/*
+	 * Calculates phases of circuits scheduled to a tile.
+	 */
+	void evaluateCircuits(const Tile& tile, const double y[], const long turns[], Scalar phases[]) const {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+
+		for (std::size_t k = tile.circuitBegin; k != tile.circuitEnd; ++k) {
+			double sum = 0.0;
+			for (std::size_t r = refStart[k], re = refStart[k + 1]; r != re; ++r) {
+				const std::size_t slot = refSlot[r];
+				sum += (y[2 * slot] + twoPi * turns[slot]) * refWeight[r];
+			}
+			phases[k] = static_cast<Scalar>(sum * square[k]);
+		}
+	}
+
+	/*
+	 * Calculates derivatives of tile contacts. Phases of all circuits
+	 * referred by the tile must be already calculated.
+	 */
+	void evaluateContacts(const Tile& tile, const double y[], const Scalar phases[], double f[]) const {
+		for (std::size_t n = tile.contactBegin, i = 2 * n; n != tile.contactEnd; ++n, i += 2) {
+			/*
+			 * y[i]    : phi(t)
+			 * y[i + 1]: u(t)
+			 * f[i]    : d(phi)/dt
+			 * f[i + 1]: d(u)/dt
+			 */
+			const Scalar phi = static_cast<Scalar>(y[i]);
+			const Scalar u = static_cast<Scalar>(y[i + 1]);
+
+			f[i] = y[i + 1];
+			f[i + 1] = invBeta[n] * (
+				twoPiZ[n]
+				+ calcCircuits(circuitRefs[n], phases)
+				- tau[n] * u
+				- v[n] * Trig::sin(phi)
+			);
+		}
+	}
+
+	Scalar* getCircuitPhases() {
+		return circuitPhases.empty() ? NULL : circuitPhases.get();
+	}
+
+private:
+
+	// contact parameters by slot
+	Buffer<Scalar> invBeta, tau, v, twoPiZ;
+	Buffer<ScalarRefPair> circuitRefs;
+
+	// circuits in schedule order, contact refs in compressed form
+	Buffer<std::size_t> refStart;
+	Buffer<std::size_t> refSlot;
+	Buffer<Scalar> refWeight;
+	Buffer<double> square;
+	Buffer<Scalar> circuitPhases;
+
+	static ScalarRef convert(const CircuitRef& ref) {
+		ScalarRef result;
+		result.index = ref.index;
+		result.gain = static_cast<Scalar>(ref.gain);
+		return result;
+	}
+
+	static Scalar calcCircuits(const ScalarRefPair& refs, const Scalar phases[]) {
+		return calcCircuit(refs.first, phases) + calcCircuit(refs.second, phases);
+	}
+
+	static Scalar calcCircuit(const ScalarRef& ref, const Scalar phases[]) {
+		if (ref.index < 0) {
+			return 0;
+		}
+
+		return phases[ref.index] * ref.gain;
+	}
+
+	void allocate(bool const hugePages) {
+		const std::size_t numOfContacts = contactAt.size();
+		const std::size_t numOfCircuits = schedule.size();
+
+		invBeta.allocate(numOfContacts, hugePages);
+		tau.allocate(numOfContacts, hugePages);
+		v.allocate(numOfContacts, hugePages);
+		twoPiZ.allocate(numOfContacts, hugePages);
+		circuitRefs.allocate(numOfContacts, hugePages);
+		winding.allocate(numOfContacts, hugePages);
+
+		refStart.allocate(numOfCircuits + 1, hugePages);
+		refSlot.allocate(refBounds.back(), hugePages);
+		refWeight.allocate(refBounds.back(), hugePages);
+		square.allocate(numOfCircuits, hugePages);
+		circuitPhases.allocate(numOfCircuits, hugePages);
+	}
+
+};
+
+#endif /* CALC_KERNEL_HPP_ */
@@ -15,18 +15,47 @@
 #define CALC_NETWORK_HPP_
 
 #include <vector>
+#include <map>
+#include <stdexcept>
 #include <boost/shared_ptr.hpp>
 #include <phlib/cloneable.hpp>
 #include "contact.hpp"
 #include "circuit.hpp"
+#include "state_view.hpp"
+#include "prop_table.hpp"
+#include "tag_expression.hpp"
+#include "parallel_query.hpp"
 
+/*
+ * Contacts and circuits of a network.
+ *
+ * While the integrator runs, contact state lives in the integrator and the
+ * network is bound to it by a StateView. Phases and voltages must be read
+ * with phase() and voltage() which use the view when the network is bound
+ * and Contact fields otherwise.
+ *
+ * Properties of contacts and circuits are kept here in typed columns
+ * indexed by element, see PropTable. Tag expressions are compiled once
+ * and cached until a new property column appears. Query results are cached
+ * too and become stale when the network generation changes, so tags and
+ * properties of elements already in the network must be changed through
+ * the network.
+ *
+ * Copies of a network share elements and properties until one of the
+ * copies is changed, so duplicating a network is cheap. Non-const access
+ * to elements gives the network its own storage first.
+ */
 class Network : public phlib::Cloneable {
 
 	virtual phlib::Cloneable* doClone() const {
 		return new Network(*this);
 	}
 
-	Network(const Network& src) : contacts(src.contacts), circuits(src.circuits) {}
+	Network(const Network& src) :
+		storage(src.storage),
+		contactExpressions(src.contactExpressions), circuitExpressions(src.circuitExpressions),
+		contactQueries(src.contactQueries), circuitQueries(src.circuitQueries),
+		generation(src.generation), state(NULL) {}
 
 public:
 
@@ -41,83 +70,171 @@ public:
 	typedef CircuitVector::iterator circuit_iterator;
 	typedef CircuitVector::const_iterator circuit_const_iterator;
 
-	Network() {
+	/*
+	 * Numeric fields of contacts (beta to voltage) and circuits (square
+	 * and flux) accessible by getField() and setField().
+	 */
+	enum Field {
+		FIELD_BETA,
+		FIELD_TAU,
+		FIELD_V,
+		FIELD_Z,
+		FIELD_PHASE,
+		FIELD_VOLTAGE,
+		FIELD_SQUARE,
+		FIELD_FLUX
+	};
+
+	Network() : storage(new Storage()), generation(0), state(NULL) {
 	}
 
 	ContactVector::size_type getNumOfContacts() const {
-		return contacts.size();
+		return storage->contacts.size();
 	}
 
 	CircuitVector::size_type getNumOfCircuits() const {
-		return circuits.size();
+		return storage->circuits.size();
 	}
 
 	Contact& contact(std::size_t const index) {
-		return contacts[index];
+		return writable().contacts[index];
 	}
 
 	const Contact& contact(std::size_t const index) const {
-		return contacts[index];
+		return storage->contacts[index];
 	}
 
 	Circuit& circuit(std::size_t const index) {
-		return circuits[index];
+		return writable().circuits[index];
 	}
 
 	const Circuit& circuit(std::size_t const index) const {
-		return circuits[index];
+		return storage->circuits[index];
 	}
 
 	contact_const_iterator contactBegin() const {
-		return contacts.begin();
+		return storage->contacts.begin();
 	}
 
 	contact_iterator contactBegin() {
-		return contacts.begin();
+		return writable().contacts.begin();
 	}
 
 	contact_const_iterator contactEnd() const {
-		return contacts.end();
+		return storage->contacts.end();
 	}
 
 	contact_iterator contactEnd() {
-		return contacts.end();
+		return writable().contacts.end();
 	}
 
 	circuit_const_iterator circuitBegin() const {
-		return circuits.begin();
+		return storage->circuits.begin();
 	}
 
 	circuit_iterator circuitBegin() {
-		return circuits.begin();
+		return writable().circuits.begin();
 	}
 
 	circuit_const_iterator circuitEnd() const {
-		return circuits.end();
+		return storage->circuits.end();
 	}
 
 	circuit_iterator circuitEnd() {
-		return circuits.end();
+		return writable().circuits.end();
 	}
 
 	std::size_t addContact(const Contact& c) {
-		const std::size_t index = contacts.size();
-		contacts.push_back(c);
+		const std::size_t index = storage->contacts.size();
+		writable().contacts.push_back(c);
+		++generation;
 		return index;
 	}
 
 	std::size_t addCircuit(const Circuit& c) {
-		const std::size_t index = circuits.size();
-		circuits.push_back(c);
+		const std::size_t index = storage->circuits.size();
+		writable().circuits.push_back(c);
+		++generation;
 		return index;
 	}
 
+	void addContactTag(const index_type contactIndex, const std::string& tag) {
+		contact(contactIndex).addTag(tag.c_str());
+		++generation;
+	}
+
+	void removeContactTag(const index_type contactIndex, const std::string& tag) {
+		contact(contactIndex).removeTag(tag.c_str());
+		++generation;
+	}
+
+	void addCircuitTag(const index_type circuitIndex, const std::string& tag) {
+		circuit(circuitIndex).addTag(tag.c_str());
+		++generation;
+	}
+
+	void removeCircuitTag(const index_type circuitIndex, const std::string& tag) {
+		circuit(circuitIndex).removeTag(tag.c_str());
+		++generation;
+	}
+
+	template <typename Type>
+	void setContactProp(const index_type contactIndex, const std::string& name, const Type& value) {
+		setProp(writable().contactProps, contactExpressions, contactIndex, name, value);
+		++generation;
+	}
+
+	template <typename Type>
+	void setCircuitProp(const index_type circuitIndex, const std::string& name, const Type& value) {
+		setProp(writable().circuitProps, circuitExpressions, circuitIndex, name, value);
+		++generation;
+	}
+
+	/*
+	 * Changes whenever tags, properties or the set of elements change.
+	 */
+	unsigned long getGeneration() const {
+		return generation;
+	}
+
+	std::string getContactProp(const index_type contactIndex, const std::string& name) const {
+		return storage->contactProps.get(contactIndex, name);
+	}
+
+	std::string getCircuitProp(const index_type circuitIndex, const std::string& name) const {
+		return storage->circuitProps.get(circuitIndex, name);
+	}
+
+	const PropTable& getContactProps() const {
+		return storage->contactProps;
+	}
+
+	const PropTable& getCircuitProps() const {
+		return storage->circuitProps;
+	}
+
+	bool contactMatches(const index_type contactIndex, const std::string& expr) const {
+		return compile(contactExpressions, storage->contactProps, expr).matches(contact(contactIndex).tags, storage->contactProps, contactIndex);
+	}
+
+	bool circuitMatches(const index_type circuitIndex, const std::string& expr) const {
+		return compile(circuitExpressions, storage->circuitProps, expr).matches(circuit(circuitIndex).tags, storage->circuitProps, circuitIndex);
+	}
+
 	IndexVector buildContactIndices(const std::string& expr) const {
-		return buildIndices(expr, contactBegin(), contactEnd());
+		return query(contactQueries, expr, contactBegin(), contactEnd(), storage->contactProps, contactExpressions);
 	}
 
 	IndexVector buildCircuitIndices(const std::string& expr) const {
-		return buildIndices(expr, circuitBegin(), circuitEnd());
+		return query(circuitQueries, expr, circuitBegin(), circuitEnd(), storage->circuitProps, circuitExpressions);
+	}
+
+	double phase(const index_type contactIndex) const {
+		return state ? state->phase(contactIndex) : contact(contactIndex).phase;
+	}
+
+	double voltage(const index_type contactIndex) const {
+		return state ? state->voltage(contactIndex) : contact(contactIndex).voltage;
 	}
 
 	double flux(const index_type circuitIndex) const {
@@ -125,25 +242,192 @@ public:
 		double sum = 0.0;
 
 		for (Circuit::const_iterator i = c.begin(), last = c.end(); i != last; ++i) {
-			sum += i->weight * contact(i->index).phase;
+			sum += i->weight * phase(i->index);
 		}
 
 		return c.square * sum;
 	}
 
+	static bool isCircuitField(const Field field) {
+		return FIELD_SQUARE == field || FIELD_FLUX == field;
+	}
+
+	static bool isReadOnlyField(const Field field) {
+		return FIELD_FLUX == field;
+	}
+
+	/*
+	 * Returns field of the contact or circuit depending on the field kind.
+	 */
+	double getField(const Field field, const index_type index) const {
+		switch (field) {
+		case FIELD_BETA:
+			return contact(index).beta;
+		case FIELD_TAU:
+			return contact(index).tau;
+		case FIELD_V:
+			return contact(index).v;
+		case FIELD_Z:
+			return contact(index).z;
+		case FIELD_PHASE:
+			return phase(index);
+		case FIELD_VOLTAGE:
+			return voltage(index);
+		case FIELD_SQUARE:
+			return circuit(index).square;
+		default:
+			return flux(index);
+		}
+	}
+
+	void setField(const Field field, const index_type index, double const value) {
+		switch (field) {
+		case FIELD_BETA:
+			contact(index).beta = value;
+			break;
+		case FIELD_TAU:
+			contact(index).tau = value;
+			break;
+		case FIELD_V:
+			contact(index).v = value;
+			break;
+		case FIELD_Z:
+			contact(index).z = value;
+			break;
+		case FIELD_PHASE:
+			contact(index).phase = value;
+			break;
+		case FIELD_VOLTAGE:
+			contact(index).voltage = value;
+			break;
+		case FIELD_SQUARE:
+			circuit(index).square = value;
+			break;
+		default:
+			throw std::invalid_argument("field is read-only");
+		}
+	}
+
+	/*
+	 * Makes the storage private to this network, non-const accessors do it
+	 * implicitly. References obtained afterwards stay valid until the
+	 * network is copied.
+	 */
+	void detach() {
+		writable();
+	}
+
+	bool isShared() const {
+		return !storage.unique();
+	}
+
+	/*
+	 * Binds the network to the state kept elsewhere, NULL unbinds it.
+	 * Contact fields are not updated while the network is bound.
+	 */
+	void bindState(const StateView* const view) {
+		state = view;
+	}
+
+	bool isStateBound() const {
+		return NULL != state;
+	}
+
 private:
 
-	ContactVector contacts;
-	CircuitVector circuits;
+	typedef std::map<std::string, boost::shared_ptr<const TagExpression> > ExpressionCache;
+	typedef std::map<std::string, IndexVector> QueryMap;
+
+	/*
+	 * Query results valid for the given network generation.
+	 */
+	struct QueryCache {
+		unsigned long generation;
+		QueryMap results;
+
+		QueryCache() : generation(0) {}
+	};
+
+	/*
+	 * Elements and their properties, shared by copies of the network
+	 * until one of them changes.
+	 */
+	struct Storage {
+		ContactVector contacts;
+		CircuitVector circuits;
+		PropTable contactProps, circuitProps;
+	};
+
+	boost::shared_ptr<Storage> storage;
+	mutable ExpressionCache contactExpressions, circuitExpressions;
+	mutable QueryCache contactQueries, circuitQueries;
+	unsigned long generation;
+	const StateView* state;
+
+	Storage& writable() {
+		if (!storage.unique()) {
+			storage.reset(new Storage(*storage));
+		}
+		return *storage;
+	}
+
+	template <typename Type>
+	static void setProp(PropTable& props, ExpressionCache& expressions, const index_type index, const std::string& name, const Type& value) {
+		const std::size_t numOfColumns = props.getNumOfColumns();
+		props.set(index, name, value);
+		if (numOfColumns != props.getNumOfColumns()) {
+			// cached expressions may refer to this property as missing
+			expressions.clear();
+		}
+	}
+
+	static const TagExpression& compile(ExpressionCache& expressions, const PropTable& props, const std::string& expr) {
+		const ExpressionCache::const_iterator i = expressions.find(expr);
+		if (i != expressions.end()) {
+			return *i->second;
+		}
+
+		const boost::shared_ptr<const TagExpression> compiled(new TagExpression(expr, props));
+		expressions.insert(std::make_pair(expr, compiled));
+		return *compiled;
+	}
 
 	template <typename Iterator>
-	IndexVector buildIndices(const std::string& expr, Iterator begin, Iterator end) const {
+	IndexVector query(QueryCache& cache, const std::string& expr, Iterator begin, Iterator end, const PropTable& props, ExpressionCache& expressions) const {
+		if (cache.generation != generation) {
+			cache.results.clear();
+			cache.generation = generation;
+		}
+
+		const QueryMap::const_iterator i = cache.results.find(expr);
+		if (i != cache.results.end()) {
+			return i->second;
+		}
+
+		return cache.results.insert(std::make_pair(expr, buildIndices(expr, begin, end, props, expressions))).first->second;
+	}
+
+	template <typename Iterator>
+	IndexVector buildIndices(const std::string& expr, Iterator begin, Iterator end, const PropTable& props, ExpressionCache& expressions) const {
 		IndexVector indices;
 
-		for (Iterator i = begin; i != end; ++i) {
-			if (expr.empty() || i->matches(expr)) {
+		if (expr.empty()) {
+			indices.reserve(std::distance(begin, end));
+			for (Iterator i = begin; i != end; ++i) {
 				indices.push_back(std::distance(begin, i));
 			}
+		} else {
+			const TagExpression& compiled = compile(expressions, props, expr);
+			IndexVector candidates;
+			if (compiled.preselect(props, candidates)) {
+				for (IndexVector::const_iterator i = candidates.begin(), last = candidates.end(); i != last; ++i) {
+					if (compiled.matches(begin[*i].tags, props, *i)) {
+						indices.push_back(*i);
+					}
+				}
+			} else {
+				ParallelQuery<Iterator>(compiled, props, begin, std::distance(begin, end)).run(indices);
+			}
 		}
 
 		return indices;
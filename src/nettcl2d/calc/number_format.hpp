@@ -0,0 +1,197 @@
+/*
+ * calc/number_format.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_NUMBER_FORMAT_HPP_
+#define CALC_NUMBER_FORMAT_HPP_
+
+#include <stdio.h>
+#include <cmath>
+#include <boost/cstdint.hpp>
+
+/*
+ * Formatting of doubles as printf() does with "%.*f" and "%.*e".
+ *
+ * A value is scaled by an exactly representable power of ten, so the
+ * scaled value has a single rounding error, and rounded to an integer
+ * which gives the digits. When the scaled value is too close to a half
+ * for its error bound to tell the rounding direction, or it does not fit
+ * the fast path at all, the C library formats the value, so results are
+ * always the same as printf() gives. Nothing is allocated.
+ *
+ * Functions write into a buffer of at least MAX_LENGTH characters and
+ * return the end of the written text, which is not terminated by zero.
+ */
+namespace number_format {
+
+	// largest precision supported
+	static const int MAX_PRECISION = 40;
+
+	// room needed for any double with a precision up to MAX_PRECISION
+	static const std::size_t MAX_LENGTH = 360;
+
+	namespace detail {
+
+		// largest precision of the fast path
+		static const int FAST_PRECISION = 17;
+
+		inline double pow10(int const n) {
+			static const double table[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+			return table[n];
+		}
+
+		inline char* fallback(char* const out, const char* const format, int const precision, double const value) {
+			const int n = snprintf(out, MAX_LENGTH, format, precision, value);
+			return out + (n < 0 ? 0 : n < static_cast<int>(MAX_LENGTH) ? n : MAX_LENGTH - 1);
+		}
+
+		/*
+		 * Rounds the scaled value to the nearest integer, returns false if
+		 * the direction cannot be told from the value with one rounding
+		 * error.
+		 */
+		inline bool round(double const y, boost::uint64_t& result) {
+			if (!(y < 4.0e15)) {
+				return false;
+			}
+
+			const double whole = std::floor(y);
+			const double fraction = y - whole;
+			if (std::fabs(fraction - 0.5) <= y * 4.0e-16) {
+				return false;
+			}
+
+			result = static_cast<boost::uint64_t>(whole) + (fraction > 0.5 ? 1 : 0);
+			return true;
+		}
+
+		// writes exactly n digits of the value
+		inline char* digits(char* const out, boost::uint64_t value, int const n) {
+			char* p = out + n;
+			while (p != out) {
+				*--p = static_cast<char>('0' + value % 10);
+				value /= 10;
+			}
+			return out + n;
+		}
+
+		// writes all digits of the value
+		inline char* digits(char* const out, boost::uint64_t const value) {
+			int n = 1;
+			for (boost::uint64_t v = value; v >= 10; v /= 10) {
+				++n;
+			}
+			return digits(out, value, n);
+		}
+
+		// true for negative values and negative zero, printf() writes a sign for both
+		inline bool negative(double const value) {
+			return value < 0.0 || (0.0 == value && 1.0 / value < 0.0);
+		}
+
+		inline boost::uint64_t power(int const n) {
+			boost::uint64_t result = 1;
+			for (int i = 0; i < n; ++i) {
+				result *= 10;
+			}
+			return result;
+		}
+
+	}
+
+	/*
+	 * Same as printf("%.*f", precision, value).
+	 */
+	inline char* fixed(char* out, double const value, int const precision) {
+		using namespace detail;
+
+		boost::uint64_t r;
+		if (precision < 0 || precision > FAST_PRECISION || !(std::fabs(value) < 1.0e15)
+				|| !round(std::fabs(value) * pow10(precision), r)) {
+			return fallback(out, "%.*f", precision, value);
+		}
+
+		if (negative(value)) {
+			*out++ = '-';
+		}
+
+		const boost::uint64_t scale = power(precision);
+		out = digits(out, r / scale);
+		if (precision > 0) {
+			*out++ = '.';
+			out = digits(out, r % scale, precision);
+		}
+		return out;
+	}
+
+	/*
+	 * Same as printf("%.*e", precision, value).
+	 */
+	inline char* scientific(char* out, double const value, int const precision) {
+		using namespace detail;
+
+		const double a = std::fabs(value);
+		if (precision < 0 || precision > FAST_PRECISION || !(a < HUGE_VAL)) {
+			return fallback(out, "%.*e", precision, value);
+		}
+
+		boost::uint64_t r = 0;
+		int exponent = 0;
+
+		if (a > 0.0) {
+			const boost::uint64_t lower = power(precision), upper = lower * 10;
+
+			// the estimate may be one off near powers of ten,
+			// a carry of rounding moves the exponent up as well
+			exponent = static_cast<int>(std::floor(std::log10(a)));
+			for (int attempt = 0; ; ++attempt) {
+				const int k = precision - exponent;
+				if (attempt > 2 || k < -22 || k > 22 || !round(k >= 0 ? a * pow10(k) : a / pow10(-k), r)) {
+					return fallback(out, "%.*e", precision, value);
+				}
+
+				if (r >= upper) {
+					++exponent;
+				} else if (r < lower) {
+					--exponent;
+				} else {
+					break;
+				}
+			}
+		}
+
+		if (negative(value)) {
+			*out++ = '-';
+		}
+
+		char buf[FAST_PRECISION + 1];
+		digits(buf, r, precision + 1);
+		*out++ = buf[0];
+		if (precision > 0) {
+			*out++ = '.';
+			for (int i = 1; i <= precision; ++i) {
+				*out++ = buf[i];
+			}
+		}
+
+		*out++ = 'e';
+		*out++ = exponent < 0 ? '-' : '+';
+		const int e = exponent < 0 ? -exponent : exponent;
+		return digits(out, e, e < 100 ? 2 : 3);
+	}
+
+}
+
+#endif /* CALC_NUMBER_FORMAT_HPP_ */
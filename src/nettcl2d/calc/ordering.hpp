@@ -0,0 +1,134 @@
+/*
+ * calc/ordering.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_ORDERING_HPP_
+#define CALC_ORDERING_HPP_
+
+#include <vector>
+#include <algorithm>
+#include "network.hpp"
+
+namespace ordering {
+
+	/*
+	 * Contact adjacency graph in compressed form: neighbours of contact i
+	 * are adjacency[start[i]] .. adjacency[start[i + 1] - 1].
+	 * Two contacts are adjacent when they belong to the same circuit.
+	 */
+	struct ContactGraph {
+		std::vector<std::size_t> start;
+		Network::IndexVector adjacency;
+
+		explicit ContactGraph(const Network& network) {
+			const std::size_t numOfContacts = network.getNumOfContacts();
+			std::vector<Network::IndexVector> neighbours(numOfContacts);
+
+			for (Network::circuit_const_iterator c = network.circuitBegin(), last = network.circuitEnd(); c != last; ++c) {
+				for (Circuit::const_iterator i = c->begin(), ie = c->end(); i != ie; ++i) {
+					for (Circuit::const_iterator j = c->begin(); j != ie; ++j) {
+						if (i->index != j->index) {
+							neighbours[i->index].push_back(j->index);
+						}
+					}
+				}
+			}
+
+			start.reserve(numOfContacts + 1);
+			start.push_back(0);
+			for (std::size_t i = 0; i < numOfContacts; ++i) {
+				Network::IndexVector& n = neighbours[i];
+				std::sort(n.begin(), n.end());
+				n.erase(std::unique(n.begin(), n.end()), n.end());
+				adjacency.insert(adjacency.end(), n.begin(), n.end());
+				start.push_back(adjacency.size());
+			}
+		}
+
+		std::size_t size() const {
+			return start.size() - 1;
+		}
+
+		std::size_t degree(Network::index_type const i) const {
+			return start[i + 1] - start[i];
+		}
+
+	};
+
+	/*
+	 * Returns contact indices in identity order.
+	 */
+	inline Network::IndexVector identity(const Network& network) {
+		Network::IndexVector order(network.getNumOfContacts());
+		for (Network::index_type i = 0, last = order.size(); i < last; ++i) {
+			order[i] = i;
+		}
+		return order;
+	}
+
+	/*
+	 * Returns contact indices in reverse Cuthill-McKee order which keeps
+	 * contacts sharing a circuit close to each other.
+	 */
+	inline Network::IndexVector reverseCuthillMcKee(const Network& network) {
+		const ContactGraph graph(network);
+		const std::size_t numOfContacts = graph.size();
+
+		// contacts sorted by degree are used to pick up a start node of every component
+		std::vector<std::pair<std::size_t, Network::index_type> > byDegree;
+		byDegree.reserve(numOfContacts);
+		for (Network::index_type i = 0; i < numOfContacts; ++i) {
+			byDegree.push_back(std::make_pair(graph.degree(i), i));
+		}
+		std::sort(byDegree.begin(), byDegree.end());
+
+		Network::IndexVector order;
+		order.reserve(numOfContacts);
+		std::vector<bool> visited(numOfContacts, false);
+		std::vector<std::pair<std::size_t, Network::index_type> > next;
+
+		for (std::size_t s = 0; s < numOfContacts; ++s) {
+			const Network::index_type root = byDegree[s].second;
+			if (visited[root]) {
+				continue;
+			}
+
+			std::size_t head = order.size();
+			visited[root] = true;
+			order.push_back(root);
+
+			while (head < order.size()) {
+				const Network::index_type node = order[head++];
+
+				next.clear();
+				for (std::size_t k = graph.start[node], ke = graph.start[node + 1]; k != ke; ++k) {
+					const Network::index_type n = graph.adjacency[k];
+					if (!visited[n]) {
+						visited[n] = true;
+						next.push_back(std::make_pair(graph.degree(n), n));
+					}
+				}
+
+				std::sort(next.begin(), next.end());
+				for (std::size_t k = 0; k < next.size(); ++k) {
+					order.push_back(next[k].second);
+				}
+			}
+		}
+
+		std::reverse(order.begin(), order.end());
+		return order;
+	}
+
+}
+
+#endif /* CALC_ORDERING_HPP_ */
@@ -0,0 +1,117 @@
+/*
+ * calc/parallel_query.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_PARALLEL_QUERY_HPP_
+#define CALC_PARALLEL_QUERY_HPP_
+
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "tag_expression.hpp"
+
+/*
+ * Evaluates a compiled tag expression over a range of elements.
+ *
+ * Large ranges are split into contiguous chunks evaluated by separate
+ * threads, one chunk per online processor, the first chunk is evaluated by
+ * the calling thread. Results of chunks are concatenated in order, so the
+ * indices come out sorted as with a serial scan. If a thread cannot be
+ * started its chunk is evaluated by the calling thread.
+ */
+template <typename Iterator>
+class ParallelQuery {
+
+	struct Chunk {
+		const ParallelQuery* query;
+		std::size_t begin, end;
+		PropTable::IndexVector indices;
+		pthread_t thread;
+		bool started;
+	};
+
+	ParallelQuery(const ParallelQuery&);
+	ParallelQuery& operator=(const ParallelQuery&);
+
+public:
+
+	// ranges shorter than this per thread are not worth a thread
+	static const std::size_t MIN_CHUNK_SIZE = 65536;
+
+	ParallelQuery(const TagExpression& expression, const PropTable& props, Iterator begin, std::size_t const size) :
+		expression(expression), props(props), begin(begin), size(size) {}
+
+	void run(PropTable::IndexVector& indices) const {
+		const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		const std::size_t numOfChunks = std::max<std::size_t>(1,
+				std::min<std::size_t>(cpus > 0 ? cpus : 1, size / MIN_CHUNK_SIZE));
+
+		if (numOfChunks == 1) {
+			scan(0, size, indices);
+			return;
+		}
+
+		std::vector<Chunk> chunks(numOfChunks);
+		for (std::size_t i = 0; i < numOfChunks; ++i) {
+			Chunk& c = chunks[i];
+			c.query = this;
+			c.begin = size * i / numOfChunks;
+			c.end = size * (i + 1) / numOfChunks;
+			c.started = i > 0 && 0 == pthread_create(&c.thread, NULL, &start, &c);
+		}
+
+		for (std::size_t i = 0; i < numOfChunks; ++i) {
+			Chunk& c = chunks[i];
+			if (c.started) {
+				pthread_join(c.thread, NULL);
+			} else {
+				scan(c.begin, c.end, c.indices);
+			}
+		}
+
+		std::size_t total = indices.size();
+		for (std::size_t i = 0; i < numOfChunks; ++i) {
+			total += chunks[i].indices.size();
+		}
+
+		indices.reserve(total);
+		for (std::size_t i = 0; i < numOfChunks; ++i) {
+			indices.insert(indices.end(), chunks[i].indices.begin(), chunks[i].indices.end());
+		}
+	}
+
+private:
+
+	const TagExpression& expression;
+	const PropTable& props;
+	const Iterator begin;
+	const std::size_t size;
+
+	void scan(std::size_t const first, std::size_t const last, PropTable::IndexVector& indices) const {
+		Iterator i = begin + first;
+		for (std::size_t index = first; index < last; ++index, ++i) {
+			if (expression.matches(i->tags, props, index)) {
+				indices.push_back(index);
+			}
+		}
+	}
+
+	static void* start(void* arg) {
+		Chunk* const c = static_cast<Chunk*>(arg);
+		c->query->scan(c->begin, c->end, c->indices);
+		return NULL;
+	}
+
+};
+
+#endif /* CALC_PARALLEL_QUERY_HPP_ */
@@ -0,0 +1,408 @@
+/*
+ * calc/partitioner.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_PARTITIONER_HPP_
+#define CALC_PARTITIONER_HPP_
+
+#include <vector>
+#include <algorithm>
+#include "network.hpp"
+
+/*
+ * Multilevel recursive bisection of the network.
+ *
+ * Contacts are graph nodes, two contacts are connected by an edge weighted
+ * by the number of circuits they share. The graph is coarsened by heavy
+ * edge matching, the coarsest graph is bisected by greedy region growing
+ * and the bisection is refined on every level while projecting it back.
+ * Parts are balanced by number of contacts and have a small number of
+ * circuits crossing their boundaries.
+ */
+namespace partitioner {
+
+	typedef std::vector<std::size_t> NodeVector;
+	typedef std::vector<unsigned> PartVector;
+
+	struct Graph {
+		// neighbours of node i are adjacency[start[i]] .. adjacency[start[i + 1] - 1]
+		NodeVector start;
+		NodeVector adjacency;
+		std::vector<unsigned> edgeWeight;
+		std::vector<unsigned> nodeWeight;
+
+		Graph() {
+			start.push_back(0);
+		}
+
+		std::size_t size() const {
+			return nodeWeight.size();
+		}
+
+		unsigned totalWeight() const {
+			unsigned sum = 0;
+			for (std::size_t i = 0; i < nodeWeight.size(); ++i) {
+				sum += nodeWeight[i];
+			}
+			return sum;
+		}
+
+		void addEdge(std::size_t const node, unsigned const weight) {
+			adjacency.push_back(node);
+			edgeWeight.push_back(weight);
+		}
+
+		void closeNode(unsigned const weight) {
+			nodeWeight.push_back(weight);
+			start.push_back(adjacency.size());
+		}
+	};
+
+	/*
+	 * Accumulates weights of edges going from a node, merging duplicates.
+	 */
+	class EdgeAccumulator {
+	public:
+
+		explicit EdgeAccumulator(std::size_t const size) : position(size, -1) {}
+
+		void add(std::size_t const node, unsigned const weight) {
+			if (position[node] < 0) {
+				position[node] = nodes.size();
+				nodes.push_back(node);
+				weights.push_back(weight);
+			} else {
+				weights[position[node]] += weight;
+			}
+		}
+
+		void flush(Graph& g, unsigned const nodeWeight) {
+			for (std::size_t i = 0; i < nodes.size(); ++i) {
+				g.addEdge(nodes[i], weights[i]);
+				position[nodes[i]] = -1;
+			}
+			g.closeNode(nodeWeight);
+			nodes.clear();
+			weights.clear();
+		}
+
+	private:
+
+		std::vector<int> position;
+		NodeVector nodes;
+		std::vector<unsigned> weights;
+	};
+
+	inline Graph buildGraph(const Network& network) {
+		const std::size_t numOfContacts = network.getNumOfContacts();
+		std::vector<NodeVector> neighbours(numOfContacts);
+
+		for (Network::circuit_const_iterator c = network.circuitBegin(), last = network.circuitEnd(); c != last; ++c) {
+			for (Circuit::const_iterator i = c->begin(), ie = c->end(); i != ie; ++i) {
+				for (Circuit::const_iterator j = c->begin(); j != ie; ++j) {
+					if (i->index != j->index) {
+						neighbours[i->index].push_back(j->index);
+					}
+				}
+			}
+		}
+
+		Graph g;
+		EdgeAccumulator acc(numOfContacts);
+		for (std::size_t i = 0; i < numOfContacts; ++i) {
+			for (NodeVector::const_iterator n = neighbours[i].begin(), last = neighbours[i].end(); n != last; ++n) {
+				acc.add(*n, 1);
+			}
+			acc.flush(g, 1);
+		}
+
+		return g;
+	}
+
+	/*
+	 * Builds a graph induced by a subset of nodes.
+	 */
+	inline Graph subgraph(const Graph& g, const NodeVector& nodes) {
+		std::vector<int> local(g.size(), -1);
+		for (std::size_t i = 0; i < nodes.size(); ++i) {
+			local[nodes[i]] = i;
+		}
+
+		Graph sub;
+		for (std::size_t i = 0; i < nodes.size(); ++i) {
+			const std::size_t node = nodes[i];
+			for (std::size_t k = g.start[node], ke = g.start[node + 1]; k != ke; ++k) {
+				if (local[g.adjacency[k]] >= 0) {
+					sub.addEdge(local[g.adjacency[k]], g.edgeWeight[k]);
+				}
+			}
+			sub.closeNode(g.nodeWeight[node]);
+		}
+
+		return sub;
+	}
+
+	/*
+	 * Matches every node with its unmatched neighbour connected by the
+	 * heaviest edge. Returns coarse graph, map receives coarse node of every
+	 * fine node.
+	 */
+	inline Graph coarsen(const Graph& g, NodeVector& map) {
+		const std::size_t size = g.size();
+		const std::size_t unmatched = size;
+		NodeVector match(size, unmatched);
+
+		map.assign(size, 0);
+		std::size_t coarseSize = 0;
+		for (std::size_t i = 0; i < size; ++i) {
+			if (match[i] != unmatched) {
+				continue;
+			}
+
+			std::size_t best = i;
+			unsigned bestWeight = 0;
+			for (std::size_t k = g.start[i], ke = g.start[i + 1]; k != ke; ++k) {
+				const std::size_t n = g.adjacency[k];
+				if (match[n] == unmatched && n != i && g.edgeWeight[k] > bestWeight) {
+					best = n;
+					bestWeight = g.edgeWeight[k];
+				}
+			}
+
+			match[i] = best;
+			match[best] = i;
+			map[i] = map[best] = coarseSize++;
+		}
+
+		Graph coarse;
+		EdgeAccumulator acc(coarseSize);
+		std::vector<bool> done(size, false);
+		for (std::size_t i = 0; i < size; ++i) {
+			if (done[i]) {
+				continue;
+			}
+
+			const std::size_t pair[2] = {i, match[i]};
+			const std::size_t count = i == match[i] ? 1 : 2;
+			unsigned weight = 0;
+
+			for (std::size_t p = 0; p < count; ++p) {
+				const std::size_t node = pair[p];
+				done[node] = true;
+				weight += g.nodeWeight[node];
+
+				for (std::size_t k = g.start[node], ke = g.start[node + 1]; k != ke; ++k) {
+					const std::size_t n = map[g.adjacency[k]];
+					if (n != map[i]) {
+						acc.add(n, g.edgeWeight[k]);
+					}
+				}
+			}
+
+			acc.flush(coarse, weight);
+		}
+
+		return coarse;
+	}
+
+	/*
+	 * Returns weight of edges connecting node with nodes of the same side
+	 * minus weight of edges connecting it with the other side.
+	 */
+	inline int internalMinusExternal(const Graph& g, const std::vector<char>& side, std::size_t const node) {
+		int sum = 0;
+		for (std::size_t k = g.start[node], ke = g.start[node + 1]; k != ke; ++k) {
+			sum += side[g.adjacency[k]] == side[node] ? static_cast<int>(g.edgeWeight[k]) : -static_cast<int>(g.edgeWeight[k]);
+		}
+		return sum;
+	}
+
+	inline unsigned cut(const Graph& g, const std::vector<char>& side) {
+		unsigned sum = 0;
+		for (std::size_t i = 0; i < g.size(); ++i) {
+			for (std::size_t k = g.start[i], ke = g.start[i + 1]; k != ke; ++k) {
+				if (side[i] != side[g.adjacency[k]]) {
+					sum += g.edgeWeight[k];
+				}
+			}
+		}
+		return sum / 2;
+	}
+
+	/*
+	 * Greedily moves boundary nodes to the other side while it reduces the
+	 * cut and keeps weight of side 0 within tolerance from target.
+	 */
+	inline void refine(const Graph& g, std::vector<char>& side, unsigned const target, unsigned const tolerance) {
+		unsigned weight0 = 0;
+		for (std::size_t i = 0; i < g.size(); ++i) {
+			if (0 == side[i]) {
+				weight0 += g.nodeWeight[i];
+			}
+		}
+
+		for (int pass = 0; pass < 8; ++pass) {
+			bool moved = false;
+
+			for (std::size_t i = 0; i < g.size(); ++i) {
+				const int gain = -internalMinusExternal(g, side, i);
+				const unsigned w = g.nodeWeight[i];
+				const unsigned newWeight0 = 0 == side[i] ? weight0 - w : weight0 + w;
+				const unsigned oldDeviation = weight0 > target ? weight0 - target : target - weight0;
+				const unsigned newDeviation = newWeight0 > target ? newWeight0 - target : target - newWeight0;
+
+				const bool balanced = newDeviation <= tolerance || newDeviation < oldDeviation;
+				if (balanced && (gain > 0 || (0 == gain && newDeviation < oldDeviation))) {
+					side[i] = 1 - side[i];
+					weight0 = newWeight0;
+					moved = true;
+				}
+			}
+
+			if (!moved) {
+				break;
+			}
+		}
+	}
+
+	/*
+	 * Grows side 0 from a seed node in breadth-first order until it reaches
+	 * target weight.
+	 */
+	inline void grow(const Graph& g, std::size_t const seed, unsigned const target, std::vector<char>& side) {
+		side.assign(g.size(), 1);
+
+		NodeVector queue;
+		std::vector<bool> queued(g.size(), false);
+		unsigned weight = 0;
+		std::size_t head = 0, next = 0;
+
+		queue.push_back(seed);
+		queued[seed] = true;
+
+		while (weight < target) {
+			if (head == queue.size()) {
+				// graph is disconnected, continue with another component
+				while (next < g.size() && queued[next]) {
+					++next;
+				}
+				if (next == g.size()) {
+					break;
+				}
+				queue.push_back(next);
+				queued[next] = true;
+			}
+
+			const std::size_t node = queue[head++];
+			side[node] = 0;
+			weight += g.nodeWeight[node];
+
+			for (std::size_t k = g.start[node], ke = g.start[node + 1]; k != ke; ++k) {
+				const std::size_t n = g.adjacency[k];
+				if (!queued[n]) {
+					queued[n] = true;
+					queue.push_back(n);
+				}
+			}
+		}
+	}
+
+	/*
+	 * Bisects graph so that side 0 has given share of total weight.
+	 */
+	inline std::vector<char> bisect(const Graph& g, double const share) {
+		const unsigned total = g.totalWeight();
+		const unsigned target = static_cast<unsigned>(total * share + 0.5);
+		const unsigned tolerance = std::max(1u, total / 100);
+		std::vector<char> side;
+
+		if (g.size() <= 64) {
+			// try several seeds and keep the best one
+			unsigned bestCut = 0;
+			const std::size_t step = std::max<std::size_t>(1, g.size() / 8);
+
+			for (std::size_t seed = 0; seed < g.size(); seed += step) {
+				std::vector<char> candidate;
+				grow(g, seed, target, candidate);
+				refine(g, candidate, target, tolerance);
+
+				const unsigned c = cut(g, candidate);
+				if (side.empty() || c < bestCut) {
+					side.swap(candidate);
+					bestCut = c;
+				}
+			}
+
+			if (side.empty()) {
+				side.assign(g.size(), 0);
+			}
+
+			return side;
+		}
+
+		NodeVector map;
+		const Graph coarse = coarsen(g, map);
+
+		if (coarse.size() * 10 > g.size() * 9) {
+			// matching does not shrink graph anymore
+			grow(g, 0, target, side);
+		} else {
+			const std::vector<char> coarseSide = bisect(coarse, share);
+			side.resize(g.size());
+			for (std::size_t i = 0; i < g.size(); ++i) {
+				side[i] = coarseSide[map[i]];
+			}
+		}
+
+		refine(g, side, target, tolerance);
+		return side;
+	}
+
+	inline void partition(const Graph& g, const NodeVector& nodes, unsigned const numOfParts, unsigned const firstPart, PartVector& parts) {
+		if (numOfParts <= 1 || nodes.size() <= 1) {
+			for (std::size_t i = 0; i < nodes.size(); ++i) {
+				parts[nodes[i]] = firstPart;
+			}
+			return;
+		}
+
+		const unsigned leftParts = numOfParts / 2;
+		const Graph sub = subgraph(g, nodes);
+		const std::vector<char> side = bisect(sub, static_cast<double>(leftParts) / numOfParts);
+
+		NodeVector left, right;
+		for (std::size_t i = 0; i < nodes.size(); ++i) {
+			(0 == side[i] ? left : right).push_back(nodes[i]);
+		}
+
+		partition(g, left, leftParts, firstPart, parts);
+		partition(g, right, numOfParts - leftParts, firstPart + leftParts, parts);
+	}
+
+	/*
+	 * Returns part number of every contact.
+	 */
+	inline PartVector partition(const Network& network, unsigned const numOfParts) {
+		const Graph g = buildGraph(network);
+		NodeVector nodes(g.size());
+		for (std::size_t i = 0; i < nodes.size(); ++i) {
+			nodes[i] = i;
+		}
+
+		PartVector parts(g.size(), 0);
+		partition(g, nodes, numOfParts, 0, parts);
+		return parts;
+	}
+
+}
+
+#endif /* CALC_PARTITIONER_HPP_ */
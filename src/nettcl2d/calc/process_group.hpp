@@ -0,0 +1,334 @@
+/*
+ * calc/process_group.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_PROCESS_GROUP_HPP_
+#define CALC_PROCESS_GROUP_HPP_
+
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include "kernel.hpp"
+
+/*
+ * Evaluates kernel in several processes sharing memory.
+ *
+ * Every part of the kernel is evaluated by its own process. Rank 0 is
+ * the calling process, other ranks are forked when the group is created.
+ * This splits computation only, not data: every fork holds the whole
+ * Network and kernel, and the whole state, derivatives, winding numbers
+ * and circuit phases live in anonymous shared memory read by all ranks,
+ * so memory per process does not shrink and there is no halo exchange.
+ * Every evaluation has two stages separated by a barrier: each rank
+ * calculates circuits of its part, then derivatives of its contacts,
+ * reading circuits of the neighbour parts from the shared phases.
+ *
+ * The integrator keeps its own state, so on every evaluation rank 0
+ * copies it into the shared state and the derivatives back, serially.
+ * That is 2N doubles each way for N contacts, about 256 MB per
+ * evaluation for a 2000x2000 grid and six evaluations per rkf45 step,
+ * which bounds the speedup well below the number of ranks. Phases are
+ * wrapped by the calling process.
+ *
+ * While rank 0 waits at the barrier it checks every WAIT_TIMEOUT_NS
+ * whether a worker has died. If one has, the others are killed and
+ * ProcessError is thrown, so the caller does not hang.
+ */
+template <typename KernelType>
+class ProcessGroup {
+
+	typedef typename KernelType::scalar_type Scalar;
+
+	enum Command {
+		COMMAND_RUN,
+		COMMAND_STOP
+	};
+
+	/*
+	 * Barrier shared by all ranks. The last rank to arrive opens the gate
+	 * of the current generation. Generations alternate between two gates,
+	 * so a rank already waiting for the next generation cannot take a
+	 * post meant for a rank still leaving the previous one.
+	 */
+	struct Control {
+		sem_t gates[2];
+		volatile unsigned arrived;
+		volatile unsigned generation;
+		volatile int command;
+	};
+
+	// how often rank 0 checks workers while waiting at the barrier
+	static const long WAIT_TIMEOUT_NS = 100000000;
+
+	ProcessGroup(const ProcessGroup&);
+	ProcessGroup& operator=(const ProcessGroup&);
+
+public:
+
+	class ProcessError : public std::runtime_error {
+	public:
+		ProcessError(const std::string& msg) : std::runtime_error(msg) {}
+	};
+
+	explicit ProcessGroup(KernelType& kernel) :
+		kernel(kernel),
+		memory(MAP_FAILED),
+		memorySize(0),
+		control(NULL),
+		y(NULL),
+		f(NULL),
+		turns(NULL),
+		phases(NULL),
+		failed(false) {
+
+		allocate();
+		spawn();
+	}
+
+	~ProcessGroup() {
+		stop();
+		release();
+	}
+
+	unsigned size() const {
+		return kernel.getParts().size();
+	}
+
+	void evaluate(const double src[], double dest[]) {
+		const std::size_t numOfEqs = kernel.getNumOfEquations();
+
+		if (failed) {
+			throw ProcessError("worker process has terminated unexpectedly");
+		}
+
+		memcpy(y, src, numOfEqs * sizeof(double));
+		control->command = COMMAND_RUN;
+		wait(0);
+		evaluatePart(0);
+		memcpy(dest, f, numOfEqs * sizeof(double));
+	}
+
+	void wrap(double y[]) {
+		if (kernel.wrap(y)) {
+			copyWinding();
+		}
+	}
+
+private:
+
+	KernelType& kernel;
+	std::vector<pid_t> workers;
+
+	void* memory;
+	std::size_t memorySize;
+	Control* control;
+	double* y;
+	double* f;
+	long* turns;
+	Scalar* phases;
+
+	// a worker has died, the group cannot evaluate any more
+	bool failed;
+
+	void allocate() {
+		const std::size_t controlSize = (sizeof(Control) + 63) / 64 * 64;
+		const std::size_t numOfEqs = kernel.getNumOfEquations();
+
+		memorySize = controlSize
+			+ 2 * numOfEqs * sizeof(double)
+			+ numOfEqs / 2 * sizeof(long)
+			+ kernel.getNumOfCircuits() * sizeof(Scalar);
+		memory = mmap(NULL, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == memory) {
+			throw ProcessError("cannot allocate shared memory");
+		}
+
+		control = new(memory) Control();
+		y = reinterpret_cast<double*>(static_cast<char*>(memory) + controlSize);
+		f = y + numOfEqs;
+		turns = reinterpret_cast<long*>(f + numOfEqs);
+		phases = reinterpret_cast<Scalar*>(turns + numOfEqs / 2);
+		copyWinding();
+
+		sem_init(&control->gates[0], 1, 0);
+		sem_init(&control->gates[1], 1, 0);
+		control->arrived = 0;
+		control->generation = 0;
+	}
+
+	void copyWinding() {
+		memcpy(turns, kernel.getWinding(), kernel.getNumOfEquations() / 2 * sizeof(long));
+	}
+
+	void release() {
+		if (MAP_FAILED != memory) {
+			sem_destroy(&control->gates[0]);
+			sem_destroy(&control->gates[1]);
+			munmap(memory, memorySize);
+			memory = MAP_FAILED;
+		}
+	}
+
+	void spawn() {
+		const pid_t parent = getpid();
+
+		for (unsigned rank = 1; rank < size(); ++rank) {
+			const pid_t pid = fork();
+
+			if (0 == pid) {
+				// worker should not outlive the calling process
+				prctl(PR_SET_PDEATHSIG, SIGKILL);
+				if (getppid() != parent) {
+					_exit(0);
+				}
+				work(rank);
+			}
+
+			if (pid < 0) {
+				kill();
+				release();
+				throw ProcessError("cannot fork worker process");
+			}
+
+			workers.push_back(pid);
+		}
+	}
+
+	// never throws, it is called by the destructor
+	void stop() {
+		if (!workers.empty()) {
+			control->command = COMMAND_STOP;
+			if (rendezvous(0)) {
+				join();
+			}
+		}
+	}
+
+	void kill() {
+		for (std::vector<pid_t>::const_iterator i = workers.begin(), last = workers.end(); i != last; ++i) {
+			if (*i > 0) {
+				::kill(*i, SIGKILL);
+			}
+		}
+		join();
+	}
+
+	void join() {
+		for (std::vector<pid_t>::const_iterator i = workers.begin(), last = workers.end(); i != last; ++i) {
+			if (*i > 0) {
+				waitpid(*i, NULL, 0);
+			}
+		}
+		workers.clear();
+	}
+
+	void wait(unsigned const rank) {
+		if (!rendezvous(rank)) {
+			throw ProcessError("worker process has terminated unexpectedly");
+		}
+	}
+
+	/*
+	 * Waits until all ranks arrive. Returns false on rank 0 if a worker
+	 * has died meanwhile, the other workers are killed then.
+	 */
+	bool rendezvous(unsigned const rank) {
+		const unsigned generation = control->generation;
+		sem_t* const gate = &control->gates[generation & 1];
+
+		if (__sync_add_and_fetch(&control->arrived, 1) == size()) {
+			control->arrived = 0;
+			__sync_add_and_fetch(&control->generation, 1);
+			for (unsigned i = 1; i < size(); ++i) {
+				sem_post(gate);
+			}
+			return true;
+		}
+
+		if (0 != rank) {
+			while (0 != sem_wait(gate) && EINTR == errno) {}
+			return true;
+		}
+
+		for (;;) {
+			timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += WAIT_TIMEOUT_NS;
+			if (deadline.tv_nsec >= 1000000000) {
+				deadline.tv_nsec -= 1000000000;
+				++deadline.tv_sec;
+			}
+
+			if (0 == sem_timedwait(gate, &deadline)) {
+				return true;
+			}
+
+			if (ETIMEDOUT == errno && !isAlive()) {
+				kill();
+				failed = true;
+				return false;
+			}
+		}
+	}
+
+	bool isAlive() {
+		for (std::vector<pid_t>::iterator i = workers.begin(), last = workers.end(); i != last; ++i) {
+			if (0 != waitpid(*i, NULL, WNOHANG)) {
+				// already reaped, join() skips it
+				*i = -1;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void work(unsigned const rank) {
+		for (;;) {
+			wait(rank);
+			if (COMMAND_STOP == control->command) {
+				_exit(0);
+			}
+			evaluatePart(rank);
+		}
+	}
+
+	void evaluatePart(unsigned const rank) {
+		const KernelLayout::TileVector& tiles = kernel.getTiles();
+		const KernelLayout::Part& part = kernel.getParts()[rank];
+
+		for (std::size_t t = part.tileBegin; t != part.tileEnd; ++t) {
+			kernel.evaluateCircuits(tiles[t], y, turns, phases);
+		}
+
+		// circuits on part boundaries are ready after this point
+		wait(rank);
+
+		for (std::size_t t = part.tileBegin; t != part.tileEnd; ++t) {
+			kernel.evaluateContacts(tiles[t], y, phases, f);
+		}
+
+		wait(rank);
+	}
+
+};
+
+#endif /* CALC_PROCESS_GROUP_HPP_ */
@@ -0,0 +1,481 @@
+/*
+ * calc/prop_table.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_PROP_TABLE_HPP_
+#define CALC_PROP_TABLE_HPP_
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <sstream>
+
+/*
+ * Properties of network elements stored by columns.
+ *
+ * Every property name is a column of integer, double or string values
+ * indexed by element. A column gets the type of its first value and is
+ * widened when a value of another type is assigned: integer to double,
+ * anything to string. Values are formatted on request exactly as they
+ * would be printed by a stream. Columns are never removed, so a column id
+ * stays valid for the lifetime of the table and its copies.
+ *
+ * Numeric columns keep a sorted index built on first range query, so a
+ * range of values is selected in O(log N + k).
+ */
+class PropTable {
+public:
+
+	enum Type {
+		TYPE_INT,
+		TYPE_DOUBLE,
+		TYPE_STRING
+	};
+
+	void set(std::size_t const index, const std::string& name, int const value) {
+		setInt(index, name, value);
+	}
+
+	void set(std::size_t const index, const std::string& name, unsigned const value) {
+		setInt(index, name, value);
+	}
+
+	void set(std::size_t const index, const std::string& name, long const value) {
+		setInt(index, name, value);
+	}
+
+	void set(std::size_t const index, const std::string& name, unsigned long const value) {
+		setInt(index, name, value);
+	}
+
+	void set(std::size_t const index, const std::string& name, double const value) {
+		setDouble(index, name, value);
+	}
+
+	void set(std::size_t const index, const std::string& name, const std::string& value) {
+		setString(index, name, value);
+	}
+
+	void set(std::size_t const index, const std::string& name, const char* const value) {
+		setString(index, name, value);
+	}
+
+	bool has(std::size_t const index, const std::string& name) const {
+		const Column* const c = find(name);
+		return c && c->has(index);
+	}
+
+	/*
+	 * Returns formatted value or empty string if the element has no such
+	 * property.
+	 */
+	std::string get(std::size_t const index, const std::string& name) const {
+		const Column* const c = find(name);
+		return c && c->has(index) ? c->format(index) : std::string();
+	}
+
+	typedef unsigned column_id;
+
+	static const column_id NOT_FOUND = ~0u;
+
+	/*
+	 * Literal value of a tag expression parsed once for comparison with
+	 * columns of any type.
+	 */
+	struct Literal {
+		std::string text;
+		long intValue;
+		double doubleValue;
+		bool isInt, isDouble;
+
+		explicit Literal(const std::string& text) : text(text) {
+			isInt = parse(text, intValue);
+			isDouble = parse(text, doubleValue);
+		}
+	};
+
+	column_id findColumn(const std::string& name) const {
+		const IdMap::const_iterator i = ids.find(name);
+		return i == ids.end() ? NOT_FOUND : i->second;
+	}
+
+	std::size_t getNumOfColumns() const {
+		return columns.size();
+	}
+
+	enum Comparison {
+		CMP_EQ,
+		CMP_NE,
+		CMP_LT,
+		CMP_LE,
+		CMP_GT,
+		CMP_GE
+	};
+
+	/*
+	 * Interval of numeric values, bounds may be infinite.
+	 */
+	struct Range {
+		double lower, upper;
+		bool lowerOpen, upperOpen;
+
+		Range() : lower(-HUGE_VAL), upper(HUGE_VAL), lowerOpen(false), upperOpen(false) {}
+
+		/*
+		 * Narrows the interval to values satisfying "value cmp bound".
+		 * Returns false if the comparison does not define an interval.
+		 */
+		bool intersect(Comparison const cmp, double const bound) {
+			switch (cmp) {
+			case CMP_EQ:
+				return intersect(CMP_GE, bound) && intersect(CMP_LE, bound);
+			case CMP_LT:
+			case CMP_LE:
+				if (bound < upper || (bound == upper && CMP_LT == cmp)) {
+					upper = bound;
+					upperOpen = CMP_LT == cmp;
+				}
+				return true;
+			case CMP_GT:
+			case CMP_GE:
+				if (bound > lower || (bound == lower && CMP_GT == cmp)) {
+					lower = bound;
+					lowerOpen = CMP_GT == cmp;
+				}
+				return true;
+			default:
+				return false;
+			}
+		}
+	};
+
+	typedef std::vector<std::size_t> IndexVector;
+
+	bool isNumeric(column_id const id) const {
+		return NOT_FOUND != id && TYPE_STRING != columns[id].type;
+	}
+
+	/*
+	 * Reads numeric property, returns false if the element has no such
+	 * property or the column is not numeric.
+	 */
+	bool getNumber(std::size_t const index, column_id const id, double& value) const {
+		if (!isNumeric(id) || !columns[id].has(index)) {
+			return false;
+		}
+
+		const Column& c = columns[id];
+		value = TYPE_INT == c.type ? c.ints[index] : c.doubles[index];
+		return true;
+	}
+
+	/*
+	 * Compares property value with a literal. Numeric columns compare
+	 * numbers, so the literal must be a number, string columns compare
+	 * strings lexicographically. Elements without the property never match.
+	 */
+	bool compare(std::size_t const index, column_id const id, Comparison const cmp, const Literal& literal) const {
+		if (NOT_FOUND == id || !columns[id].has(index)) {
+			return false;
+		}
+
+		const Column& c = columns[id];
+		int sign;
+		switch (c.type) {
+		case TYPE_INT:
+			if (literal.isInt) {
+				sign = c.ints[index] < literal.intValue ? -1 : (c.ints[index] > literal.intValue ? 1 : 0);
+			} else if (literal.isDouble) {
+				sign = sgn(c.ints[index] - literal.doubleValue);
+			} else {
+				return false;
+			}
+			break;
+
+		case TYPE_DOUBLE:
+			if (!literal.isDouble) {
+				return false;
+			}
+			sign = sgn(c.doubles[index] - literal.doubleValue);
+			break;
+
+		default:
+			sign = c.strings[index].compare(literal.text);
+		}
+
+		switch (cmp) {
+		case CMP_EQ:
+			return 0 == sign;
+		case CMP_NE:
+			return 0 != sign;
+		case CMP_LT:
+			return sign < 0;
+		case CMP_LE:
+			return sign <= 0;
+		case CMP_GT:
+			return sign > 0;
+		default:
+			return sign >= 0;
+		}
+	}
+
+	bool equals(std::size_t const index, column_id const id, const Literal& literal) const {
+		return compare(index, id, CMP_EQ, literal);
+	}
+
+	/*
+	 * Number of elements whose numeric property lies within the range.
+	 */
+	std::size_t count(column_id const id, const Range& range) const {
+		std::pair<SortedIndex::const_iterator, SortedIndex::const_iterator> bounds = find(id, range);
+		return bounds.second - bounds.first;
+	}
+
+	/*
+	 * Appends indices of elements whose numeric property lies within the
+	 * range, in no particular order.
+	 */
+	void select(column_id const id, const Range& range, IndexVector& indices) const {
+		std::pair<SortedIndex::const_iterator, SortedIndex::const_iterator> bounds = find(id, range);
+		for (SortedIndex::const_iterator i = bounds.first; i != bounds.second; ++i) {
+			indices.push_back(i->second);
+		}
+	}
+
+	bool equals(std::size_t const index, const std::string& name, const std::string& literal) const {
+		return equals(index, findColumn(name), Literal(literal));
+	}
+
+private:
+
+	typedef std::vector<std::pair<double, std::size_t> > SortedIndex;
+
+	struct Column {
+		Type type;
+		std::vector<long> ints;
+		std::vector<double> doubles;
+		std::vector<std::string> strings;
+		std::vector<bool> present;
+
+		// values of present elements with their indices, empty when stale
+		mutable SortedIndex sorted;
+
+		explicit Column(Type const type) : type(type) {}
+
+		bool has(std::size_t const index) const {
+			return index < present.size() && present[index];
+		}
+
+		void reserve(std::size_t const index) {
+			if (index >= present.size()) {
+				present.resize(index + 1, false);
+				switch (type) {
+				case TYPE_INT:
+					ints.resize(index + 1, 0);
+					break;
+				case TYPE_DOUBLE:
+					doubles.resize(index + 1, 0.0);
+					break;
+				default:
+					strings.resize(index + 1);
+				}
+			}
+			present[index] = true;
+			SortedIndex().swap(sorted);
+		}
+
+		const SortedIndex& sortedIndex() const {
+			if (sorted.empty()) {
+				for (std::size_t i = 0; i < present.size(); ++i) {
+					if (present[i]) {
+						sorted.push_back(std::make_pair(TYPE_INT == type ? double(ints[i]) : doubles[i], i));
+					}
+				}
+				std::sort(sorted.begin(), sorted.end());
+			}
+			return sorted;
+		}
+
+		std::string format(std::size_t const index) const {
+			std::stringstream s;
+			switch (type) {
+			case TYPE_INT:
+				s << ints[index];
+				break;
+			case TYPE_DOUBLE:
+				s << doubles[index];
+				break;
+			default:
+				return strings[index];
+			}
+			return s.str();
+		}
+
+		void widen(Type const to) {
+			if (TYPE_DOUBLE == to) {
+				doubles.assign(ints.begin(), ints.end());
+				std::vector<long>().swap(ints);
+			} else {
+				std::vector<std::string> values(present.size());
+				for (std::size_t i = 0; i < present.size(); ++i) {
+					if (present[i]) {
+						values[i] = format(i);
+					}
+				}
+				strings.swap(values);
+				std::vector<long>().swap(ints);
+				std::vector<double>().swap(doubles);
+			}
+			type = to;
+		}
+	};
+
+	typedef std::map<std::string, column_id> IdMap;
+
+	IdMap ids;
+	std::vector<Column> columns;
+
+	const Column* find(const std::string& name) const {
+		const column_id id = findColumn(name);
+		return NOT_FOUND == id ? NULL : &columns[id];
+	}
+
+	struct LessValue {
+		bool operator()(const SortedIndex::value_type& a, double const b) const {
+			return a.first < b;
+		}
+
+		bool operator()(double const a, const SortedIndex::value_type& b) const {
+			return a < b.first;
+		}
+	};
+
+	std::pair<SortedIndex::const_iterator, SortedIndex::const_iterator> find(column_id const id, const Range& range) const {
+		const SortedIndex& sorted = columns[id].sortedIndex();
+		const SortedIndex::const_iterator first = range.lowerOpen
+			? std::upper_bound(sorted.begin(), sorted.end(), range.lower, LessValue())
+			: std::lower_bound(sorted.begin(), sorted.end(), range.lower, LessValue());
+		const SortedIndex::const_iterator last = range.upperOpen
+			? std::lower_bound(first, sorted.end(), range.upper, LessValue())
+			: std::upper_bound(first, sorted.end(), range.upper, LessValue());
+		return std::make_pair(first, std::max(first, last));
+	}
+
+	static int sgn(double const v) {
+		return v < 0.0 ? -1 : (v > 0.0 ? 1 : 0);
+	}
+
+	Column& column(const std::string& name, Type const type) {
+		const IdMap::const_iterator i = ids.find(name);
+		if (i == ids.end()) {
+			ids.insert(std::make_pair(name, column_id(columns.size())));
+			columns.push_back(Column(type));
+			return columns.back();
+		}
+
+		Column& c = columns[i->second];
+		if (c.type < type) {
+			c.widen(type);
+		}
+		return c;
+	}
+
+	void setInt(std::size_t const index, const std::string& name, long const value) {
+		Column& c = column(name, TYPE_INT);
+		c.reserve(index);
+		switch (c.type) {
+		case TYPE_INT:
+			c.ints[index] = value;
+			break;
+		case TYPE_DOUBLE:
+			c.doubles[index] = value;
+			break;
+		default: {
+			std::stringstream s;
+			s << value;
+			c.strings[index] = s.str();
+		}
+		}
+	}
+
+	void setDouble(std::size_t const index, const std::string& name, double const value) {
+		Column& c = column(name, TYPE_DOUBLE);
+		c.reserve(index);
+		if (TYPE_DOUBLE == c.type) {
+			c.doubles[index] = value;
+		} else {
+			std::stringstream s;
+			s << value;
+			c.strings[index] = s.str();
+		}
+	}
+
+	void setString(std::size_t const index, const std::string& name, const std::string& value) {
+		Column& c = column(name, TYPE_STRING);
+		c.reserve(index);
+		c.strings[index] = value;
+	}
+
+	static bool parse(const std::string& s, long& value) {
+		char* end;
+		value = std::strtol(s.c_str(), &end, 10);
+		return !s.empty() && '\0' == *end;
+	}
+
+	// takes decimal numbers only, strtod would also take nan, inf and hex
+	static bool parse(const std::string& s, double& value) {
+		if (!isDecimal(s)) {
+			return false;
+		}
+		value = std::strtod(s.c_str(), NULL);
+		return std::isfinite(value);
+	}
+
+	// [-]digits[.digits][(e|E)[+|-]digits]
+	static bool isDecimal(const std::string& s) {
+		std::string::const_iterator i = s.begin(), last = s.end();
+		if (i != last && '-' == *i) {
+			++i;
+		}
+		if (!skipDigits(i, last)) {
+			return false;
+		}
+		if (i != last && '.' == *i && !skipDigits(++i, last)) {
+			return false;
+		}
+		if (i != last && ('e' == *i || 'E' == *i)) {
+			if (++i != last && ('+' == *i || '-' == *i)) {
+				++i;
+			}
+			if (!skipDigits(i, last)) {
+				return false;
+			}
+		}
+		return i == last;
+	}
+
+	// returns false if there is no digit
+	static bool skipDigits(std::string::const_iterator& i, std::string::const_iterator const last) {
+		const std::string::const_iterator start = i;
+		while (i != last && '0' <= *i && *i <= '9') {
+			++i;
+		}
+		return i != start;
+	}
+
+};
+
+#endif /* CALC_PROP_TABLE_HPP_ */
@@ -0,0 +1,94 @@
+/*
+ * calc/spsc_queue.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_SPSC_QUEUE_HPP_
+#define CALC_SPSC_QUEUE_HPP_
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Bounded queue passing values from one producer thread to one consumer
+ * thread without locks.
+ *
+ * Only the producer writes the tail and only the consumer writes the
+ * head, a memory barrier orders every index update after the access to
+ * the slot it guards. Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscQueue {
+
+	SpscQueue(const SpscQueue&);
+	SpscQueue& operator=(const SpscQueue&);
+
+public:
+
+	explicit SpscQueue(std::size_t const capacity) :
+		items(roundUp(capacity)), mask(items.size() - 1), head(0), tail(0) {}
+
+	/*
+	 * Called by the producer, returns false if the queue is full.
+	 */
+	bool push(const T& item) {
+		const std::size_t t = tail;
+		if (t - head == items.size()) {
+			return false;
+		}
+
+		items[t & mask] = item;
+		// the item is stored before the consumer sees the new tail
+		__sync_synchronize();
+		tail = t + 1;
+		return true;
+	}
+
+	/*
+	 * Called by the consumer, returns false if the queue is empty.
+	 */
+	bool pop(T& item) {
+		const std::size_t h = head;
+		if (h == tail) {
+			return false;
+		}
+
+		// the item is loaded after the tail it was published with
+		__sync_synchronize();
+		item = items[h & mask];
+		// and before the producer may reuse the slot
+		__sync_synchronize();
+		head = h + 1;
+		return true;
+	}
+
+private:
+
+	// cache line apart, so the threads do not invalidate each other's index
+	static const std::size_t CACHE_LINE = 64;
+
+	std::vector<T> items;
+	const std::size_t mask;
+	volatile std::size_t head;
+	char padding[CACHE_LINE];
+	volatile std::size_t tail;
+
+	static std::size_t roundUp(std::size_t const capacity) {
+		std::size_t result = 1;
+		while (result < capacity) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+};
+
+#endif /* CALC_SPSC_QUEUE_HPP_ */
@@ -0,0 +1,50 @@
+/*
+ * calc/state_view.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_STATE_VIEW_HPP_
+#define CALC_STATE_VIEW_HPP_
+
+#include <cstddef>
+
+/*
+ * Read-only view of contact state kept by the integrator.
+ *
+ * State of the contact placed into slot s is y[2 * s] (phase wrapped to
+ * [-pi, pi)) and y[2 * s + 1] (voltage), winding[s] counts whole turns
+ * removed from the phase. Contacts are mapped to slots by slots[index].
+ */
+class StateView {
+public:
+
+	StateView(const double y[], const long winding[], const std::size_t slots[]) :
+		y(y), winding(winding), slots(slots) {}
+
+	double phase(std::size_t const index) const {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+		const std::size_t slot = slots[index];
+		return y[2 * slot] + twoPi * winding[slot];
+	}
+
+	double voltage(std::size_t const index) const {
+		return y[2 * slots[index] + 1];
+	}
+
+private:
+
+	const double* y;
+	const long* winding;
+	const std::size_t* slots;
+
+};
+
+#endif /* CALC_STATE_VIEW_HPP_ */
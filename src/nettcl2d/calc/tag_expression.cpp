@@ -0,0 +1,246 @@
+/*
+ * calc/tag_expression.cpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * The grammar is based on a calculator example taken from the link below
+ * http://www.oreillynet.com/network/2003/05/06/examples/calculatorexample.html
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/spirit/include/classic.hpp>
+#include "tag_expression.hpp"
+
+struct TagExpressionCompiler : boost::spirit::classic::grammar<TagExpressionCompiler> {
+
+	TagExpressionCompiler(TagExpression& expression, const PropTable& props) :
+		expression(expression), props(props), cmp(PropTable::CMP_EQ) {}
+
+	// Semantic actions append instructions to the program. Comparison is
+	// emitted only when it is parsed completely, so backtracking from
+	// "name = value" to a plain tag leaves no garbage behind.
+
+	struct Assign {
+		std::string& target;
+
+		Assign(std::string& target) : target(target) {}
+
+		template <typename IteratorT>
+		void operator()(IteratorT first, IteratorT last) const {
+			target.assign(first, last);
+		}
+	};
+
+	struct SetRelation {
+		const TagExpressionCompiler& self;
+		PropTable::Comparison cmp;
+
+		SetRelation(const TagExpressionCompiler& self, PropTable::Comparison const cmp) : self(self), cmp(cmp) {}
+
+		template <typename IteratorT>
+		void operator()(IteratorT, IteratorT) const {
+			self.cmp = cmp;
+		}
+
+		template <typename CharT>
+		void operator()(CharT) const {
+			self.cmp = cmp;
+		}
+	};
+
+	struct EmitTag {
+		const TagExpressionCompiler& self;
+
+		EmitTag(const TagExpressionCompiler& self) : self(self) {}
+
+		template <typename IteratorT>
+		void operator()(IteratorT first, IteratorT last) const {
+			self.emitTag(std::string(first, last));
+		}
+	};
+
+	struct EmitComparison {
+		const TagExpressionCompiler& self;
+
+		EmitComparison(const TagExpressionCompiler& self) : self(self) {}
+
+		template <typename IteratorT>
+		void operator()(IteratorT, IteratorT) const {
+			self.emitComparison();
+		}
+	};
+
+	struct EmitOp {
+		const TagExpressionCompiler& self;
+		TagExpression::OpCode code;
+
+		EmitOp(const TagExpressionCompiler& self, TagExpression::OpCode const code) : self(self), code(code) {}
+
+		template <typename IteratorT>
+		void operator()(IteratorT, IteratorT) const {
+			self.expression.program.push_back(TagExpression::Op(code));
+		}
+	};
+
+	template <typename ScannerT>
+	struct definition {
+		definition(TagExpressionCompiler const& self) {
+			using namespace boost::spirit::classic;
+
+			// The lexeme_d directive tells the scanner to treat white space as
+			// significant. Thus, an identifier cannot have internal white space.
+			identifier =
+				lexeme_d[
+					+( alnum_p | '_' | '-')
+				];
+
+			// a sign may follow the exponent mark of a number such as 1e-5
+			literal	=
+				lexeme_d[
+					!ch_p('-') >> +((chset_p("eE") >> (ch_p('+') | '-') >> digit_p) | alnum_p | '.')
+				];
+
+			relation =
+				str_p("<=")[SetRelation(self, PropTable::CMP_LE)]
+				| str_p(">=")[SetRelation(self, PropTable::CMP_GE)]
+				| str_p("!=")[SetRelation(self, PropTable::CMP_NE)]
+				| ch_p('<')[SetRelation(self, PropTable::CMP_LT)]
+				| ch_p('>')[SetRelation(self, PropTable::CMP_GT)]
+				| ch_p('=')[SetRelation(self, PropTable::CMP_EQ)];
+
+			group =
+				'('	>> expression >> ')';
+
+			statement =
+				expression >> end_p;
+
+			comparison =
+				(identifier[Assign(self.name)] >> relation >> literal[Assign(self.value)])[EmitComparison(self)];
+
+			factor =
+				group
+				| comparison
+				| identifier[EmitTag(self)];
+
+			term =
+				factor >> *('&' >> factor[EmitOp(self, TagExpression::OP_AND)]);
+
+			expression =
+				term >> *('|' >> term[EmitOp(self, TagExpression::OP_OR)]);
+		}
+
+		// The start symbol is returned from start().
+		boost::spirit::classic::rule<ScannerT> const& start() const {
+			return statement;
+		}
+
+		boost::spirit::classic::rule<ScannerT> statement, identifier, literal, relation, comparison, expression, factor, group, term;
+	};
+
+	void emitTag(const std::string& tag) const {
+		expression.program.push_back(TagExpression::Op(TagExpression::OP_TAG, TagDictionary::intern(tag)));
+	}
+
+	void emitComparison() const {
+		expression.program.push_back(TagExpression::Op(
+				TagExpression::OP_PROP, props.findColumn(name), expression.literals.size(), cmp));
+		expression.literals.push_back(PropTable::Literal(value));
+	}
+
+	TagExpression& expression;
+	const PropTable& props;
+	mutable std::string name, value;
+	mutable PropTable::Comparison cmp;
+
+};
+
+TagExpression::TagExpression(const std::string& expression, const PropTable& props) {
+	using namespace boost::spirit::classic;
+
+	TagExpressionCompiler compiler(*this, props);
+
+	parse_info<std::string::const_iterator> info = parse(expression.begin(), expression.end(), compiler, space_p);
+	if (!info.hit) {
+		throw ParseException(std::string(expression.begin(), info.stop));
+	} else if (!info.full) {
+		throw ParseException(std::string("expression is not full"));
+	}
+
+	// every operand takes one bit of the evaluation stack,
+	// starts[i] is the first instruction of the operand ending at i
+	std::vector<std::size_t> starts(program.size()), stack;
+	for (std::size_t i = 0; i < program.size(); ++i) {
+		if (OP_TAG == program[i].code || OP_PROP == program[i].code) {
+			if (stack.size() == 64) {
+				throw ParseException(std::string("expression is too complex"));
+			}
+			starts[i] = i;
+			stack.push_back(i);
+		} else {
+			stack.pop_back();
+			starts[i] = stack.back();
+		}
+	}
+
+	collectConjuncts(program.size() - 1, starts);
+}
+
+void TagExpression::collectConjuncts(std::size_t const end, const std::vector<std::size_t>& starts) {
+	if (OP_AND == program[end].code) {
+		collectConjuncts(end - 1, starts);
+		collectConjuncts(starts[end - 1] - 1, starts);
+	} else if (OP_PROP == program[end].code && PropTable::CMP_NE != program[end].cmp) {
+		conjuncts.push_back(program[end]);
+	}
+}
+
+bool TagExpression::preselect(const PropTable& props, PropTable::IndexVector& candidates) const {
+	PropTable::column_id best = PropTable::NOT_FOUND;
+	PropTable::Range bestRange;
+	std::size_t bestCount = 0;
+
+	for (std::vector<Op>::const_iterator i = conjuncts.begin(), last = conjuncts.end(); i != last; ++i) {
+		if (!props.isNumeric(i->id)) {
+			continue;
+		}
+
+		PropTable::Range range;
+		for (std::vector<Op>::const_iterator j = conjuncts.begin(); j != last; ++j) {
+			if (j->id == i->id && !literals[j->literal].isDouble) {
+				// a numeric property never compares with a non-numeric literal
+				candidates.clear();
+				return true;
+			} else if (j->id == i->id) {
+				range.intersect(j->cmp, literals[j->literal].doubleValue);
+			}
+		}
+
+		const std::size_t count = props.count(i->id, range);
+		if (PropTable::NOT_FOUND == best || count < bestCount) {
+			best = i->id;
+			bestRange = range;
+			bestCount = count;
+		}
+	}
+
+	if (PropTable::NOT_FOUND == best) {
+		return false;
+	}
+
+	candidates.clear();
+	candidates.reserve(bestCount);
+	props.select(best, bestRange, candidates);
+	std::sort(candidates.begin(), candidates.end());
+	return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * calc/tag_expression.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_TAG_EXPRESSION_HPP_
+#define CALC_TAG_EXPRESSION_HPP_
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "tagable.hpp"
+#include "prop_table.hpp"
+
+/*
+ * Tag expression compiled into a postfix program.
+ *
+ *	 tag         ::= (<latin letter> | <digit> | '-' | '_')+
+ *	 value       ::= ['-'] (<latin letter> | <digit> | '.')+
+ *	 relation    ::= '=' | '!=' | '<' | '<=' | '>' | '>='
+ *	 group       ::= '(' expression ')'
+ *	 factor      ::= group | prop relation value | tag
+ *	 term        ::= factor ('&' factor)*
+ *	 expression  ::= term ('|' term)*
+ *
+ * Tag names are interned and property names are resolved to columns of
+ * the given table when the expression is compiled, so evaluation does no
+ * lookups by name. The program is bound to the table it was compiled
+ * against and must be recompiled when a column is added to the table.
+ *
+ * Comparisons joined to the rest of the expression by '&' at the top
+ * level are remembered, so elements may be preselected by the sorted
+ * index of a numeric property instead of scanning all of them.
+ */
+class TagExpression {
+public:
+
+	typedef Tagable::ParseException ParseException;
+
+	TagExpression(const std::string& expression, const PropTable& props);
+
+	bool matches(const TagSet& tags, const PropTable& props, std::size_t const index) const {
+		// operand stack, one bit per value
+		boost::uint64_t stack = 0;
+
+		for (std::vector<Op>::const_iterator i = program.begin(), last = program.end(); i != last; ++i) {
+			switch (i->code) {
+			case OP_TAG:
+				stack = (stack << 1) | (tags.contains(i->id) ? 1 : 0);
+				break;
+
+			case OP_PROP:
+				stack = (stack << 1) | (props.compare(index, i->id, i->cmp, literals[i->literal]) ? 1 : 0);
+				break;
+
+			case OP_AND:
+				stack = (stack >> 1) & (stack | ~boost::uint64_t(1));
+				break;
+
+			case OP_OR:
+				stack = (stack >> 1) | (stack & 1);
+				break;
+			}
+		}
+
+		return 0 != (stack & 1);
+	}
+
+	/*
+	 * Collects elements that may match the expression using the most
+	 * selective numeric range of the top level conjunction. The indices
+	 * are sorted, every one still has to be checked with matches().
+	 * Returns false if no range applies and all elements must be checked.
+	 */
+	bool preselect(const PropTable& props, PropTable::IndexVector& candidates) const;
+
+private:
+
+	friend struct TagExpressionCompiler;
+
+	enum OpCode {
+		OP_TAG,
+		OP_PROP,
+		OP_AND,
+		OP_OR
+	};
+
+	struct Op {
+		OpCode code;
+		unsigned id;
+		unsigned literal;
+		PropTable::Comparison cmp;
+
+		Op(OpCode const code, unsigned const id = 0, unsigned const literal = 0, PropTable::Comparison const cmp = PropTable::CMP_EQ) :
+			code(code), id(id), literal(literal), cmp(cmp) {}
+	};
+
+	std::vector<Op> program;
+	std::vector<PropTable::Literal> literals;
+
+	// comparisons every matching element satisfies
+	std::vector<Op> conjuncts;
+
+	void collectConjuncts(std::size_t end, const std::vector<std::size_t>& starts);
+
+};
+
+#endif /* CALC_TAG_EXPRESSION_HPP_ */
@@ -0,0 +1,160 @@
+/*
+ * calc/tag_set.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_TAG_SET_HPP_
+#define CALC_TAG_SET_HPP_
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+/*
+ * Dictionary of tag names shared by all elements of all networks.
+ *
+ * Every name gets a small integer id on first use, ids are never reused.
+ * Elements are tagged before they are added to a network, so the
+ * dictionary is process-wide rather than per network.
+ */
+class TagDictionary {
+
+	TagDictionary() {}
+	TagDictionary(const TagDictionary&);
+	TagDictionary& operator=(const TagDictionary&);
+
+public:
+
+	typedef unsigned id_type;
+
+	static const id_type NOT_FOUND = ~0u;
+
+	static id_type intern(const std::string& name) {
+		TagDictionary& d = instance();
+		const std::map<std::string, id_type>::const_iterator i = d.ids.find(name);
+		if (i != d.ids.end()) {
+			return i->second;
+		}
+
+		const id_type id = d.names.size();
+		d.names.push_back(name);
+		d.ids.insert(std::make_pair(name, id));
+		return id;
+	}
+
+	static id_type find(const std::string& name) {
+		const TagDictionary& d = instance();
+		const std::map<std::string, id_type>::const_iterator i = d.ids.find(name);
+		return i == d.ids.end() ? NOT_FOUND : i->second;
+	}
+
+	static const std::string& name(id_type const id) {
+		return instance().names[id];
+	}
+
+private:
+
+	std::map<std::string, id_type> ids;
+	std::deque<std::string> names;
+
+	static TagDictionary& instance() {
+		static TagDictionary dictionary;
+		return dictionary;
+	}
+
+};
+
+/*
+ * Set of tag ids stored as a bitset. The first 64 ids are kept inline,
+ * further words are allocated only when such tags are used.
+ */
+class TagSet {
+
+	typedef boost::uint64_t word_type;
+
+	static const unsigned WORD_BITS = 64;
+
+public:
+
+	typedef TagDictionary::id_type id_type;
+	typedef std::vector<id_type> IdVector;
+
+	TagSet() : bits(0) {}
+
+	void insert(id_type const id) {
+		if (id < WORD_BITS) {
+			bits |= mask(id);
+		} else {
+			const std::size_t w = id / WORD_BITS - 1;
+			if (w >= overflow.size()) {
+				overflow.resize(w + 1, 0);
+			}
+			overflow[w] |= mask(id);
+		}
+	}
+
+	void erase(id_type const id) {
+		if (id < WORD_BITS) {
+			bits &= ~mask(id);
+		} else {
+			const std::size_t w = id / WORD_BITS - 1;
+			if (w < overflow.size()) {
+				overflow[w] &= ~mask(id);
+			}
+		}
+	}
+
+	bool contains(id_type const id) const {
+		if (id < WORD_BITS) {
+			return 0 != (bits & mask(id));
+		}
+
+		const std::size_t w = id / WORD_BITS - 1;
+		return w < overflow.size() && 0 != (overflow[w] & mask(id));
+	}
+
+	bool empty() const {
+		if (bits) {
+			return false;
+		}
+
+		for (std::vector<word_type>::const_iterator i = overflow.begin(), last = overflow.end(); i != last; ++i) {
+			if (*i) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	IdVector ids() const {
+		IdVector result;
+		for (id_type id = 0, last = (overflow.size() + 1) * WORD_BITS; id < last; ++id) {
+			if (contains(id)) {
+				result.push_back(id);
+			}
+		}
+		return result;
+	}
+
+private:
+
+	word_type bits;
+	std::vector<word_type> overflow;
+
+	static word_type mask(id_type const id) {
+		return word_type(1) << (id % WORD_BITS);
+	}
+
+};
+
+#endif /* CALC_TAG_SET_HPP_ */
@@ -15,19 +15,17 @@
 #define CALC_TAGGABLE_HPP_
 
 #include <string>
-#include <set>
-#include <map>
+#include <vector>
+#include <algorithm>
 #include <stdexcept>
-#include <sstream>
 #include "point.hpp"
+#include "tag_set.hpp"
 
 struct Tagable {
 
-	typedef std::set<std::string> TagContainer;
-	typedef TagContainer::const_iterator const_tag_iterator;
-
-	typedef std::map<std::string, std::string> PropContainer;
-	typedef PropContainer::const_iterator const_prop_iterator;
+	typedef TagSet TagContainer;
+	typedef std::vector<std::string> TagNameVector;
+	typedef TagNameVector::const_iterator const_tag_iterator;
 
 	struct ParseException : public std::invalid_argument {
 
@@ -36,20 +34,19 @@ struct Tagable {
 	};
 
 	TagContainer tags;
-	PropContainer props;
 
 	Tagable() {}
 
-	Tagable(const Tagable& src) : tags(src.tags), props(src.props) {}
+	Tagable(const Tagable& src) : tags(src.tags) {}
 
 	void addTag(const char* const tag) {
-		tags.insert(tag);
+		tags.insert(TagDictionary::intern(tag));
 	}
 
 	void removeTag(const char* const tag) {
-		TagContainer::iterator i = tags.find(tag);
-		if (i != tags.end()) {
-			tags.erase(i);
+		const TagDictionary::id_type id = TagDictionary::find(tag);
+		if (TagDictionary::NOT_FOUND != id) {
+			tags.erase(id);
 		}
 	}
 
@@ -58,42 +55,28 @@ struct Tagable {
 	}
 
 	bool hasTag(const std::string& tag) const {
-		return "*" == tag || tags.end() != tags.find(tag);
-	}
-
-	bool hasTags(const TagContainer& c) const {
-		for (TagContainer::const_iterator i = c.begin(), last = c.end(); i != last; ++i) {
-			if (hasTag(*i)) {
-				return true;
-			}
+		if ("*" == tag) {
+			return true;
 		}
-		return false;
-	}
 
-	template <typename Type>
-	void setProp(const std::string& name, const Type& value) {
-		std::stringstream s;
-		s << value;
-		props[name] = s.str();
+		const TagDictionary::id_type id = TagDictionary::find(tag);
+		return TagDictionary::NOT_FOUND != id && tags.contains(id);
 	}
 
-	const std::string& getProp(const std::string& name) const {
-		static const std::string empty;
-		const Tagable::PropContainer::const_iterator i = props.find(name);
-		return i == props.end() ? empty : i->second;
-	}
+	/*
+	 * Returns tag names in alphabetical order.
+	 */
+	TagNameVector getTags() const {
+		const TagSet::IdVector ids = tags.ids();
+		TagNameVector names;
+
+		names.reserve(ids.size());
+		for (TagSet::IdVector::const_iterator i = ids.begin(), last = ids.end(); i != last; ++i) {
+			names.push_back(TagDictionary::name(*i));
+		}
+		std::sort(names.begin(), names.end());
 
-	/**
-	 tag         ::= '*' | (<latin letter> | <digit> | '-' | '_')+
-	 group       ::= '(' expression ')'
-     factor      ::= group | prop = <value> | tag
-     term        ::= factor ('&' factor)*
-     expression  ::= term ('|' term)*
-    */
-	bool matches(const std::string& expression) const;
-
-	const TagContainer& getTags() const {
-		return tags;
+		return names;
 	}
 
 };
@@ -0,0 +1,306 @@
+/*
+ * calc/thread_group.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_THREAD_GROUP_HPP_
+#define CALC_THREAD_GROUP_HPP_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <vector>
+#include "network.hpp"
+#include "kernel.hpp"
+
+/*
+ * Evaluates kernel in several threads of the calling process.
+ *
+ * Every part of the kernel is evaluated by its own thread, rank 0 is the
+ * calling thread. The kernel must be prepared but not filled: every rank
+ * fills working arrays and state of its part itself, so on a NUMA system
+ * the memory of a part is placed on the node of the thread using it.
+ * Threads may be pinned to processors, rank r runs on processor
+ * affinity[r % affinity.size()].
+ *
+ * Evaluation works in place on the state and derivative arrays of the
+ * solver and has the same two stages as ProcessGroup. Phases of the
+ * state are wrapped by every rank in its own part.
+ */
+template <typename KernelType>
+class ThreadGroup {
+
+	typedef typename KernelType::scalar_type Scalar;
+
+	enum Command {
+		COMMAND_INIT,
+		COMMAND_RUN,
+		COMMAND_WRAP,
+		COMMAND_STOP
+	};
+
+	struct Worker {
+		ThreadGroup* group;
+		unsigned rank;
+		pthread_t thread;
+	};
+	typedef std::vector<Worker> WorkerVector;
+
+	ThreadGroup(const ThreadGroup&);
+	ThreadGroup& operator=(const ThreadGroup&);
+
+public:
+
+	typedef std::vector<int> AffinityVector;
+
+	class ThreadError : public std::runtime_error {
+	public:
+		ThreadError(const std::string& msg) : std::runtime_error(msg) {}
+	};
+
+	ThreadGroup(KernelType& kernel, const Network& network, double y[], const AffinityVector& affinity) :
+		kernel(kernel),
+		network(&network),
+		affinity(affinity),
+		command(COMMAND_INIT),
+		pinned(false),
+		state(y),
+		y(NULL),
+		f(NULL) {
+
+		pthread_barrier_init(&barrier, NULL, size());
+		pthread_mutex_init(&startup, NULL);
+
+		try {
+			pin();
+			spawn();
+		} catch (...) {
+			unpin();
+			pthread_mutex_destroy(&startup);
+			pthread_barrier_destroy(&barrier);
+			throw;
+		}
+
+		wait();
+		initPart(0);
+		wait();
+
+		kernel.finish();
+		this->network = NULL;
+	}
+
+	~ThreadGroup() {
+		command = COMMAND_STOP;
+		wait();
+		join();
+		unpin();
+
+		pthread_mutex_destroy(&startup);
+		pthread_barrier_destroy(&barrier);
+	}
+
+	unsigned size() const {
+		return kernel.getParts().size();
+	}
+
+	void evaluate(const double src[], double dest[]) {
+		y = src;
+		f = dest;
+		command = COMMAND_RUN;
+		wait();
+		evaluatePart(0);
+	}
+
+	void wrap(double y[]) {
+		state = y;
+		command = COMMAND_WRAP;
+		wait();
+		kernel.wrapPart(state, 0);
+		wait();
+	}
+
+private:
+
+	KernelType& kernel;
+	const Network* network;
+	const AffinityVector affinity;
+	WorkerVector workers;
+
+	pthread_barrier_t barrier;
+	pthread_mutex_t startup;
+	volatile int command;
+
+	bool pinned;
+	cpu_set_t savedAffinity;
+
+	// state of the solver
+	double* state;
+
+	const double* y;
+	double* f;
+
+	bool getCpuSet(unsigned const rank, cpu_set_t& set) const {
+		if (affinity.empty()) {
+			return false;
+		}
+
+		const int cpu = affinity[rank % affinity.size()];
+		if (cpu < 0 || cpu >= CPU_SETSIZE) {
+			throw ThreadError("wrong processor number in affinity list");
+		}
+
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return true;
+	}
+
+	void pin() {
+		cpu_set_t set;
+		if (getCpuSet(0, set)) {
+			pthread_getaffinity_np(pthread_self(), sizeof(savedAffinity), &savedAffinity);
+			if (0 != pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+				throw ThreadError("cannot set thread affinity");
+			}
+			pinned = true;
+		}
+	}
+
+	void unpin() {
+		if (pinned) {
+			pthread_setaffinity_np(pthread_self(), sizeof(savedAffinity), &savedAffinity);
+			pinned = false;
+		}
+	}
+
+	void spawn() {
+		workers.reserve(size());
+
+		// workers wait on the mutex until all of them are started
+		pthread_mutex_lock(&startup);
+
+		for (unsigned rank = 1; rank < size(); ++rank) {
+			Worker w = {this, rank, pthread_t()};
+			workers.push_back(w);
+
+			pthread_attr_t attr;
+			pthread_attr_init(&attr);
+
+			cpu_set_t set;
+			int rc = 0;
+			try {
+				if (getCpuSet(rank, set)) {
+					rc = pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+				}
+			} catch (...) {
+				pthread_attr_destroy(&attr);
+				workers.pop_back();
+				abort();
+				throw;
+			}
+
+			if (0 == rc) {
+				rc = pthread_create(&workers.back().thread, &attr, &start, &workers.back());
+			}
+			pthread_attr_destroy(&attr);
+
+			if (0 != rc) {
+				workers.pop_back();
+				abort();
+				throw ThreadError("cannot start worker thread");
+			}
+		}
+
+		pthread_mutex_unlock(&startup);
+	}
+
+	void abort() {
+		command = COMMAND_STOP;
+		pthread_mutex_unlock(&startup);
+		join();
+	}
+
+	void join() {
+		for (typename WorkerVector::const_iterator i = workers.begin(), last = workers.end(); i != last; ++i) {
+			pthread_join(i->thread, NULL);
+		}
+		workers.clear();
+	}
+
+	void wait() {
+		pthread_barrier_wait(&barrier);
+	}
+
+	static void* start(void* arg) {
+		Worker* const w = static_cast<Worker*>(arg);
+		w->group->work(w->rank);
+		return NULL;
+	}
+
+	void work(unsigned const rank) {
+		pthread_mutex_lock(&startup);
+		pthread_mutex_unlock(&startup);
+
+		if (COMMAND_STOP == command) {
+			// group failed to start
+			return;
+		}
+
+		for (;;) {
+			wait();
+			switch (command) {
+			case COMMAND_INIT:
+				initPart(rank);
+				wait();
+				break;
+
+			case COMMAND_RUN:
+				evaluatePart(rank);
+				break;
+
+			case COMMAND_WRAP:
+				kernel.wrapPart(state, rank);
+				wait();
+				break;
+
+			default:
+				return;
+			}
+		}
+	}
+
+	void initPart(unsigned const rank) {
+		kernel.initPart(*network, rank);
+		kernel.loadPart(*network, state, rank);
+	}
+
+	void evaluatePart(unsigned const rank) {
+		const KernelLayout::TileVector& tiles = kernel.getTiles();
+		const KernelLayout::Part& part = kernel.getParts()[rank];
+		const long* const turns = kernel.getWinding();
+		Scalar* const phases = kernel.getCircuitPhases();
+
+		for (std::size_t t = part.tileBegin; t != part.tileEnd; ++t) {
+			kernel.evaluateCircuits(tiles[t], y, turns, phases);
+		}
+
+		// circuits on part boundaries are ready after this point
+		wait();
+
+		for (std::size_t t = part.tileBegin; t != part.tileEnd; ++t) {
+			kernel.evaluateContacts(tiles[t], y, phases, f);
+		}
+
+		wait();
+	}
+
+};
+
+#endif /* CALC_THREAD_GROUP_HPP_ */
@@ -0,0 +1,345 @@
+/*
+ * calc/trace_file.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_TRACE_FILE_HPP_
+#define CALC_TRACE_FILE_HPP_
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include "xor_codec.hpp"
+
+/*
+ * Header of a binary trace file.
+ *
+ * The header is followed by the tracer type and the column names, each
+ * terminated by zero, padded with zeroes up to dataOffset. Records follow,
+ * every record is a time stored as a double and a value of every column
+ * stored in valueSize bytes, i.e. as a double or a float. Numbers are in
+ * the byte order of the machine which wrote the file.
+ *
+ * With ENCODING_XOR records are grouped into blocks, every block starts
+ * with the number of its records and the number of bytes of the records
+ * compressed by xor_codec, both stored as 32 bit integers.
+ */
+struct TraceHeader {
+
+	static const boost::uint32_t BYTE_ORDER_MARK = 0x01020304;
+	static const boost::uint32_t CURRENT_VERSION = 2;
+
+	enum Encoding {
+		ENCODING_RAW,
+		ENCODING_XOR
+	};
+
+	char magic[8];
+	boost::uint32_t byteOrder;
+	boost::uint32_t version;
+	boost::uint32_t valueSize;
+	boost::uint32_t numOfColumns;
+	boost::uint32_t encoding;
+	boost::uint32_t reserved;
+	boost::uint64_t dataOffset;
+	double startTime;
+	double interval;
+
+	static const char* signature() {
+		return "NT2DTRC";
+	}
+
+	bool isValid() const {
+		return 0 == std::memcmp(magic, signature(), sizeof(magic))
+			&& BYTE_ORDER_MARK == byteOrder
+			&& CURRENT_VERSION == version
+			&& (sizeof(double) == valueSize || sizeof(float) == valueSize)
+			&& (ENCODING_RAW == encoding || ENCODING_XOR == encoding);
+	}
+
+	std::size_t getRecordSize() const {
+		return sizeof(double) + numOfColumns * valueSize;
+	}
+
+};
+
+/*
+ * Binary trace file mapped into memory for reading.
+ *
+ * Records are read by scan(), compressed records are decoded on the fly.
+ * Records of a file without compression may be also accessed directly. A
+ * record or a block cut short by an interrupted run is ignored, a block
+ * which cannot hold its records or does not decode is FormatException.
+ */
+class TraceFile {
+
+	TraceFile(const TraceFile&);
+	TraceFile& operator=(const TraceFile&);
+
+public:
+
+	static const std::size_t NOT_FOUND = ~std::size_t(0);
+
+	class FormatException : public std::runtime_error {
+	public:
+		FormatException(const std::string& message) : std::runtime_error(message) {}
+	};
+
+	/*
+	 * Values of a record passed to a visitor of scan().
+	 */
+	class Values {
+	public:
+
+		double operator[](std::size_t const column) const {
+			return decoded ? decoded[column] : file.value(record, column);
+		}
+
+	private:
+
+		friend class TraceFile;
+
+		const TraceFile& file;
+		const std::size_t record;
+		const double* const decoded;
+
+		Values(const TraceFile& file, std::size_t const record, const double* const decoded) :
+			file(file), record(record), decoded(decoded) {}
+
+	};
+
+	explicit TraceFile(const std::string& fileName) : data(NULL), size(0) {
+		const int fd = open(fileName.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw FormatException("cannot open " + fileName);
+		}
+
+		struct stat st;
+		if (0 == fstat(fd, &st) && static_cast<std::size_t>(st.st_size) >= sizeof(TraceHeader)) {
+			size = st.st_size;
+			void* const p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+			data = MAP_FAILED == p ? NULL : static_cast<const char*>(p);
+		}
+		close(fd);
+
+		if (!data) {
+			throw FormatException("cannot map " + fileName);
+		}
+
+		std::memcpy(&header, data, sizeof(header));
+		// names start after the header and records at a multiple of eight bytes
+		if (!header.isValid() || header.dataOffset > size
+				|| header.dataOffset <= sizeof(TraceHeader) || 0 != header.dataOffset % 8) {
+			release();
+			throw FormatException("not a trace file " + fileName);
+		}
+
+		// tracer type and column names
+		const char* s = data + sizeof(header);
+		const char* const last = data + header.dataOffset;
+		for (std::size_t i = 0; i <= header.numOfColumns; ++i) {
+			const char* const end = static_cast<const char*>(std::memchr(s, 0, last - s));
+			if (!end) {
+				release();
+				throw FormatException("not a trace file " + fileName);
+			}
+			if (0 == i) {
+				type.assign(s, end);
+			} else {
+				columns.push_back(std::string(s, end));
+			}
+			s = end + 1;
+		}
+
+		if (TraceHeader::ENCODING_XOR == header.encoding) {
+			if (!findBlocks()) {
+				release();
+				throw FormatException("corrupt block in " + fileName);
+			}
+		} else {
+			numOfRecords = (size - header.dataOffset) / header.getRecordSize();
+			dataEnd = header.dataOffset + numOfRecords * header.getRecordSize();
+		}
+	}
+
+	~TraceFile() {
+		release();
+	}
+
+	const std::string& getType() const {
+		return type;
+	}
+
+	const std::vector<std::string>& getColumns() const {
+		return columns;
+	}
+
+	std::size_t findColumn(const std::string& name) const {
+		for (std::size_t i = 0; i < columns.size(); ++i) {
+			if (columns[i] == name) {
+				return i;
+			}
+		}
+		return NOT_FOUND;
+	}
+
+	std::size_t getValueSize() const {
+		return header.valueSize;
+	}
+
+	bool isCompressed() const {
+		return TraceHeader::ENCODING_XOR == header.encoding;
+	}
+
+	double getStartTime() const {
+		return header.startTime;
+	}
+
+	double getInterval() const {
+		return header.interval;
+	}
+
+	std::size_t getNumOfRecords() const {
+		return numOfRecords;
+	}
+
+	/*
+	 * Returns the length of the file without a record or a block cut
+	 * short, records may be appended from there.
+	 */
+	std::size_t getDataEnd() const {
+		return dataEnd;
+	}
+
+	/*
+	 * Calls visitor(time, values) for count records starting with first.
+	 * Throws FormatException if a compressed block is corrupt.
+	 */
+	template <typename Visitor>
+	void scan(std::size_t const first, std::size_t count, Visitor& visitor) const {
+		if (!isCompressed()) {
+			for (std::size_t i = first; count > 0; ++i, --count) {
+				visitor(time(i), Values(*this, i, NULL));
+			}
+			return;
+		}
+
+		std::vector<double> values(columns.size() + 1);
+		for (std::vector<Block>::const_iterator b = blocks.begin(), last = blocks.end(); count > 0 && b != last; ++b) {
+			if (b->first + b->count <= first) {
+				// the block is skipped without decoding
+				continue;
+			}
+
+			xor_codec::Decoder decoder(reinterpret_cast<const unsigned char*>(data) + b->offset, b->size, columns.size(), header.valueSize);
+			for (std::size_t i = b->first; count > 0 && i < b->first + b->count; ++i) {
+				double t;
+				if (!decoder.decode(t, &values[0])) {
+					throw FormatException("corrupt block");
+				}
+				if (i >= first) {
+					visitor(t, Values(*this, i, &values[0]));
+					--count;
+				}
+			}
+		}
+	}
+
+	// direct access to records without compression
+
+	double time(std::size_t const record) const {
+		double result;
+		std::memcpy(&result, this->record(record), sizeof(result));
+		return result;
+	}
+
+	double value(std::size_t const record, std::size_t const column) const {
+		const char* const p = this->record(record) + sizeof(double) + column * header.valueSize;
+
+		if (sizeof(float) == header.valueSize) {
+			float result;
+			std::memcpy(&result, p, sizeof(result));
+			return result;
+		} else {
+			double result;
+			std::memcpy(&result, p, sizeof(result));
+			return result;
+		}
+	}
+
+private:
+
+	const char* data;
+	std::size_t size;
+	TraceHeader header;
+	std::string type;
+	std::vector<std::string> columns;
+	std::size_t numOfRecords;
+	std::size_t dataEnd;
+
+	struct Block {
+		std::size_t offset;
+		std::size_t size;
+		std::size_t first;
+		std::size_t count;
+	};
+
+	std::vector<Block> blocks;
+
+	// returns false if a block cannot hold its records
+	bool findBlocks() {
+		numOfRecords = 0;
+		dataEnd = header.dataOffset;
+
+		// every record takes at least a bit per column and the time
+		const boost::uint64_t minRecordBits = header.numOfColumns + 1;
+
+		std::size_t offset = header.dataOffset;
+		while (offset + 2 * sizeof(boost::uint32_t) <= size) {
+			boost::uint32_t counts[2];
+			std::memcpy(counts, data + offset, sizeof(counts));
+			offset += sizeof(counts);
+			if (counts[1] > size - offset) {
+				break;
+			}
+			if (counts[0] * minRecordBits > boost::uint64_t(counts[1]) * 8) {
+				return false;
+			}
+
+			const Block block = {offset, counts[1], numOfRecords, counts[0]};
+			blocks.push_back(block);
+			numOfRecords += counts[0];
+			offset += counts[1];
+			dataEnd = offset;
+		}
+		return true;
+	}
+
+	const char* record(std::size_t const index) const {
+		return data + header.dataOffset + index * header.getRecordSize();
+	}
+
+	void release() {
+		if (data) {
+			munmap(const_cast<char*>(data), size);
+			data = NULL;
+		}
+	}
+
+};
+
+#endif /* CALC_TRACE_FILE_HPP_ */
@@ -0,0 +1,363 @@
+/*
+ * calc/xor_codec.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_XOR_CODEC_HPP_
+#define CALC_XOR_CODEC_HPP_
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+/*
+ * Lossless compression of trace records by XOR of successive values of
+ * a column, as done by the Gorilla time series database.
+ *
+ * Every value is XORed with a prediction: the two previous values of its
+ * column extrapolated linearly, so the delta of delta is what is encoded,
+ * or the previous value alone if there is one only or the extrapolation is
+ * not finite. The extrapolation uses IEEE arithmetic of the column type,
+ * so the decoder predicts the same bits. A zero result takes one bit '0'.
+ * Otherwise '1' is followed by '0' and the meaningful bits if they fit the
+ * window of leading and trailing zeros of the previous nonzero result, or
+ * by '1', 5 bits of the number of leading zeros, 6 bits of the number of
+ * meaningful bits less one and the meaningful bits, which sets the new
+ * window. The first value of a column is stored as is. Time is stored as a
+ * 64 bit double, values as 64 bit doubles or 32 bit floats. Bits are
+ * written from the most significant one.
+ *
+ * Records are grouped into blocks which are encoded independently, so a
+ * reader skips blocks without decoding them. The decoder checks every
+ * window it reads and fails rather than shifting by a wrong count on
+ * corrupt data.
+ */
+namespace xor_codec {
+
+	class BitWriter {
+	public:
+
+		BitWriter() : acc(0), bits(0) {}
+
+		// writes n lowest bits of the value, n is 1 to 64
+		void write(boost::uint64_t const value, unsigned const n) {
+			if (n > 32) {
+				writeShort((value >> 32) & ((boost::uint64_t(1) << (n - 32)) - 1), n - 32);
+				writeShort(value & 0xffffffffu, 32);
+			} else {
+				writeShort(value & ((boost::uint64_t(1) << n) - 1), n);
+			}
+		}
+
+		// pads the last byte with zero bits
+		void finish() {
+			while (bits > 0) {
+				writeShort(0, 1);
+			}
+		}
+
+		const std::vector<unsigned char>& getBytes() const {
+			return bytes;
+		}
+
+		void clear() {
+			bytes.clear();
+			acc = 0;
+			bits = 0;
+		}
+
+	private:
+
+		std::vector<unsigned char> bytes;
+		boost::uint64_t acc;
+		unsigned bits;
+
+		// n is up to 32, so the accumulator never holds more than 39 bits
+		void writeShort(boost::uint64_t const value, unsigned const n) {
+			acc = (acc << n) | value;
+			bits += n;
+			while (bits >= 8) {
+				bits -= 8;
+				bytes.push_back(static_cast<unsigned char>(acc >> bits));
+			}
+			acc &= (boost::uint64_t(1) << bits) - 1;
+		}
+
+	};
+
+	class BitReader {
+	public:
+
+		BitReader(const unsigned char* const data, std::size_t const size) :
+			p(data), end(data + size), acc(0), bits(0), overrun(false) {}
+
+		// reads n bits, n is 1 to 64, missing bits read as zeroes
+		boost::uint64_t read(unsigned const n) {
+			if (n <= 32) {
+				return readShort(n);
+			}
+			const boost::uint64_t high = readShort(n - 32);
+			return (high << 32) | readShort(32);
+		}
+
+		// true if more bits were read than the data holds
+		bool isOverrun() const {
+			return overrun;
+		}
+
+	private:
+
+		const unsigned char* p;
+		const unsigned char* const end;
+		boost::uint64_t acc;
+		unsigned bits;
+		bool overrun;
+
+		boost::uint64_t readShort(unsigned const n) {
+			while (bits < n) {
+				if (p < end) {
+					acc = (acc << 8) | *p++;
+				} else {
+					acc <<= 8;
+					overrun = true;
+				}
+				bits += 8;
+			}
+			bits -= n;
+			const boost::uint64_t result = (acc >> bits) & ((boost::uint64_t(1) << n) - 1);
+			acc &= (boost::uint64_t(1) << bits) - 1;
+			return result;
+		}
+
+	};
+
+	inline boost::uint64_t toBits(double const v) {
+		boost::uint64_t result;
+		std::memcpy(&result, &v, sizeof(result));
+		return result;
+	}
+
+	inline boost::uint32_t toBits(float const v) {
+		boost::uint32_t result;
+		std::memcpy(&result, &v, sizeof(result));
+		return result;
+	}
+
+	inline double toDouble(boost::uint64_t const bits) {
+		double result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	inline float toFloat(boost::uint32_t const bits) {
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	/*
+	 * State of one column, width is 64 or 32 bits.
+	 */
+	struct Column {
+		boost::uint64_t previous;
+		boost::uint64_t older;
+		unsigned count;
+		unsigned leading;
+		unsigned trailing;
+
+		Column() : previous(0), older(0), count(0), leading(0), trailing(0) {}
+
+		// two previous values extrapolated in the type of the column
+		boost::uint64_t predict(unsigned const width) const {
+			if (count < 2) {
+				return previous;
+			} else if (32 == width) {
+				const float a = toFloat(static_cast<boost::uint32_t>(previous));
+				const float p = a + (a - toFloat(static_cast<boost::uint32_t>(older)));
+				return p - p == 0 ? toBits(p) : previous;
+			} else {
+				const double a = toDouble(previous);
+				const double p = a + (a - toDouble(older));
+				return p - p == 0 ? toBits(p) : previous;
+			}
+		}
+
+		void push(boost::uint64_t const value) {
+			older = previous;
+			previous = value;
+			if (count < 2) {
+				++count;
+			}
+		}
+
+		void encode(BitWriter& w, boost::uint64_t const value, unsigned const width) {
+			if (0 == count) {
+				w.write(value, width);
+				push(value);
+				// no window yet
+				leading = width;
+				return;
+			}
+
+			const boost::uint64_t x = value ^ predict(width);
+			push(value);
+
+			if (0 == x) {
+				w.write(0, 1);
+				return;
+			}
+
+			unsigned lz = __builtin_clzll(x) - (64 - width);
+			const unsigned tz = __builtin_ctzll(x);
+			if (lz > 31) {
+				lz = 31;
+			}
+
+			if (lz >= leading && tz >= trailing) {
+				w.write(2, 2);
+				w.write(x >> trailing, width - leading - trailing);
+			} else {
+				const unsigned length = width - lz - tz;
+				w.write(3, 2);
+				w.write(lz, 5);
+				w.write(length - 1, 6);
+				w.write(x >> tz, length);
+				leading = lz;
+				trailing = tz;
+			}
+		}
+
+		// returns false if the window read does not fit the width
+		bool decode(BitReader& r, unsigned const width, boost::uint64_t& value) {
+			if (0 == count) {
+				push(r.read(width));
+				leading = width;
+				value = previous;
+				return true;
+			}
+
+			value = predict(width);
+			if (r.read(1)) {
+				if (r.read(1)) {
+					const unsigned lz = r.read(5);
+					const unsigned length = r.read(6) + 1;
+					if (lz + length > width) {
+						return false;
+					}
+					leading = lz;
+					trailing = width - lz - length;
+				} else if (leading + trailing >= width) {
+					// no window to reuse yet
+					return false;
+				}
+				value ^= r.read(width - leading - trailing) << trailing;
+			}
+			push(value);
+			return true;
+		}
+	};
+
+	/*
+	 * Encodes records of a block.
+	 */
+	class Encoder {
+	public:
+
+		Encoder(std::size_t const numOfColumns, std::size_t const valueSize) :
+			columns(numOfColumns + 1), width(valueSize * 8), numOfRecords(0) {}
+
+		void encode(double const time, const double values[]) {
+			columns[0].encode(writer, toBits(time), 64);
+			for (std::size_t i = 1; i < columns.size(); ++i) {
+				if (32 == width) {
+					columns[i].encode(writer, toBits(static_cast<float>(values[i - 1])), 32);
+				} else {
+					columns[i].encode(writer, toBits(values[i - 1]), 64);
+				}
+			}
+			++numOfRecords;
+		}
+
+		std::size_t getNumOfRecords() const {
+			return numOfRecords;
+		}
+
+		std::size_t getSize() const {
+			return writer.getBytes().size();
+		}
+
+		/*
+		 * Completes the block and returns its bytes, valid until reset().
+		 */
+		const std::vector<unsigned char>& finish() {
+			writer.finish();
+			return writer.getBytes();
+		}
+
+		void reset() {
+			writer.clear();
+			std::fill(columns.begin(), columns.end(), Column());
+			numOfRecords = 0;
+		}
+
+	private:
+
+		BitWriter writer;
+		std::vector<Column> columns;
+		const unsigned width;
+		std::size_t numOfRecords;
+
+	};
+
+	/*
+	 * Decodes records of a block one after another.
+	 */
+	class Decoder {
+	public:
+
+		Decoder(const unsigned char* const data, std::size_t const size, std::size_t const numOfColumns, std::size_t const valueSize) :
+			reader(data, size), columns(numOfColumns + 1), width(valueSize * 8) {}
+
+		/*
+		 * Decodes the next record, returns false if the data are corrupt.
+		 */
+		bool decode(double& time, double values[]) {
+			boost::uint64_t bits;
+			if (!columns[0].decode(reader, 64, bits)) {
+				return false;
+			}
+			time = toDouble(bits);
+
+			for (std::size_t i = 1; i < columns.size(); ++i) {
+				if (!columns[i].decode(reader, width, bits)) {
+					return false;
+				}
+				if (32 == width) {
+					values[i - 1] = toFloat(static_cast<boost::uint32_t>(bits));
+				} else {
+					values[i - 1] = toDouble(bits);
+				}
+			}
+			return !reader.isOverrun();
+		}
+
+	private:
+
+		BitReader reader;
+		std::vector<Column> columns;
+		const unsigned width;
+
+	};
+
+}
+
+#endif /* CALC_XOR_CODEC_HPP_ */
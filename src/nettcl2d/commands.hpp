@@ -21,6 +21,7 @@
 #include "proc/circuit_wrapper.hpp"
 #include "proc/tracer_wrapper.hpp"
 #include "proc/integrator_wrapper.hpp"
+#include "proc/trace_wrapper.hpp"
 #include "proc/version.hpp"
 
 void initCommands(Tcl_Interp *interp) {
@@ -48,6 +49,8 @@ void initCommands(Tcl_Interp *interp) {
 	proc::PerturbatorWrapper::registerType();
 	proc::PerturbatorWrapper::registerCommands(interp);
 
+	proc::TraceWrapper::registerCommands(interp);
+
 	proc::Version::registerCommands(interp);
 }
 
@@ -29,6 +29,7 @@ namespace proc {
 		const char* tracer = "tracer";
 		const char* integrator = "integrator";
 		const char* perturbator = "perturbator";
+		const char* trace = "trace";
 		const char* version = "version";
 	}
 }
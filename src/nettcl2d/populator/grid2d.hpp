@@ -74,40 +74,40 @@ namespace populator {
 
 					if (col > 0) {
 						xIndex = network.addContact(Contact(params.betaRng(), params.tauRng(), params.vRng()));
-						network.contact(xIndex).addTag("horizontal");
-						network.contact(xIndex).setProp("x", col - 1);
-						network.contact(xIndex).setProp("y", row);
+						network.addContactTag(xIndex, "horizontal");
+						network.setContactProp(xIndex, "x", col - 1);
+						network.setContactProp(xIndex, "y", row);
 
 						if (row == 0) {
-							network.contact(xIndex).addTag("bottom");
-							network.contact(xIndex).addTag("boundary");
+							network.addContactTag(xIndex, "bottom");
+							network.addContactTag(xIndex, "boundary");
 						}
 						else if (row == params.rows - 1) {
-							network.contact(xIndex).addTag("top");
-							network.contact(xIndex).addTag("boundary");
+							network.addContactTag(xIndex, "top");
+							network.addContactTag(xIndex, "boundary");
 						}
 						else {
-							network.contact(xIndex).addTag("inner");
+							network.addContactTag(xIndex, "inner");
 						}
 						xIndices[row].push_back(xIndex);
 					}
 
 					if (row > 0) {
 						yIndex = network.addContact(Contact(params.betaRng(), params.tauRng(), params.vRng()));
-						network.contact(yIndex).addTag("vertical");
-						network.contact(yIndex).setProp("x", col);
-						network.contact(yIndex).setProp("y", row - 1);
+						network.addContactTag(yIndex, "vertical");
+						network.setContactProp(yIndex, "x", col);
+						network.setContactProp(yIndex, "y", row - 1);
 
 						if (col == 0) {
-							network.contact(yIndex).addTag("left");
-							network.contact(yIndex).addTag("boundary");
+							network.addContactTag(yIndex, "left");
+							network.addContactTag(yIndex, "boundary");
 						}
 						else if (col == params.columns - 1) {
-							network.contact(yIndex).addTag("right");
-							network.contact(yIndex).addTag("boundary");
+							network.addContactTag(yIndex, "right");
+							network.addContactTag(yIndex, "boundary");
 						}
 						else {
-							network.contact(yIndex).addTag("inner");
+							network.addContactTag(yIndex, "inner");
 						}
 						yIndices[row].push_back(yIndex);
 					}
@@ -129,9 +129,6 @@ namespace populator {
 						// right
 						c.addContactRef(ContactRef(yIndex, 1.0, -1.0));
 
-						c.setProp("x", col - 1);
-						c.setProp("y", row - 1);
-
 						if (col == 1) {
 							c.addTag("left");
 							c.addTag("boundary");
@@ -156,7 +153,9 @@ namespace populator {
 							c.addTag("inner");
 						}
 
-						network.addCircuit(c);
+						const std::size_t cIndex = network.addCircuit(c);
+						network.setCircuitProp(cIndex, "x", col - 1);
+						network.setCircuitProp(cIndex, "y", row - 1);
 					}
 				}
 			}
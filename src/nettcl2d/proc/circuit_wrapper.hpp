@@ -44,8 +44,24 @@ namespace proc {
 			return new CircuitWrapper(*this);
 		}
 
-		virtual Tagable& tagable() {
-			return circuit();
+		virtual const Tagable& tagable() {
+			return constCircuit();
+		}
+
+		virtual std::string prop(const std::string& name) {
+			return network->getCircuitProp(index, name);
+		}
+
+		virtual bool match(const std::string& expr) {
+			return network->circuitMatches(index, expr);
+		}
+
+		virtual void tag(const std::string& name) {
+			network->addCircuitTag(index, name);
+		}
+
+		virtual void untag(const std::string& name) {
+			network->removeCircuitTag(index, name);
 		}
 
 		static int doMain(ClientData clientData, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
@@ -86,7 +102,7 @@ namespace proc {
 			const std::string param = Tcl_GetStringFromObj(objv[0], NULL);
 
 			if ("square" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(circuit().square));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(constCircuit().square));
 			} else if ("flux" == param) {
 				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(network->flux(index)));
 			} else if ("tags" == param) {
@@ -117,6 +133,12 @@ namespace proc {
 			return network->circuit(index);
 		}
 
+		// reading through the non-const network would unshare its storage
+		const Circuit& constCircuit() const {
+			const Network& net = *network;
+			return net.circuit(index);
+		}
+
 	public:
 
 		static void registerCommands(Tcl_Interp * interp) {
@@ -45,8 +45,24 @@ namespace proc {
 			return new ContactWrapper(*this);
 		}
 
-		virtual Tagable& tagable() {
-			return contact();
+		virtual const Tagable& tagable() {
+			return constContact();
+		}
+
+		virtual std::string prop(const std::string& name) {
+			return network->getContactProp(index, name);
+		}
+
+		virtual bool match(const std::string& expr) {
+			return network->contactMatches(index, expr);
+		}
+
+		virtual void tag(const std::string& name) {
+			network->addContactTag(index, name);
+		}
+
+		virtual void untag(const std::string& name) {
+			network->removeContactTag(index, name);
 		}
 
 		static int doMain(ClientData clientData, Tcl_Interp * interp, int objc, Tcl_Obj * const objv[]) {
@@ -85,7 +101,7 @@ namespace proc {
 				throw WrongNumArgs(interp, 0, objv, "parameter");
 
 			const std::string param = Tcl_GetStringFromObj(objv[0], NULL);
-			const Contact& c = contact();
+			const Contact& c = constContact();
 
 			if ("beta" == param) {
 				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.beta));
@@ -96,9 +112,9 @@ namespace proc {
 			} else if ("z" == param) {
 				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.z));
 			} else if ("phase" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.phase));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(network->phase(index)));
 			} else if ("voltage" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.voltage));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(network->voltage(index)));
 			} else if ("tags" == param) {
 				Tcl_SetObjResult(interp, getTagsObj(interp));
 			} else {
@@ -137,6 +153,12 @@ namespace proc {
 			return network->contact(index);
 		}
 
+		// reading through the non-const network would unshare its storage
+		const Contact& constContact() const {
+			const Network& net = *network;
+			return net.contact(index);
+		}
+
 	public:
 
 		static void registerCommands(Tcl_Interp * interp) {
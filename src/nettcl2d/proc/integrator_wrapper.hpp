@@ -106,8 +106,8 @@ namespace proc {
 		}
 
 		static int create(Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
-			if (objc > 2)
-				throw WrongNumArgs(interp, 0, objv, "?step? ?delta?");
+			if (objc > 3)
+				throw WrongNumArgs(interp, 0, objv, "?step? ?delta? ?precision?");
 
 			Integrator::Params params;
 			if (objc > 0) {
@@ -116,6 +116,9 @@ namespace proc {
 			if (objc > 1) {
 				params.delta = phlib::TclUtils::getDouble(interp, objv[1]);
 			}
+			if (objc > 2) {
+				params.precision = parsePrecision(interp, objv[2]);
+			}
 
 			// instantiate new TCL object
 			Tcl_Obj* const w = Tcl_NewObj();
@@ -136,8 +139,28 @@ namespace proc {
 				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(engine->getParams().step));
 			} else if ("delta" == param) {
 				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(engine->getParams().delta));
+			} else if ("tile-size" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewIntObj(engine->getParams().tileSize));
+			} else if ("ordering" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(KernelLayout::ORDERING_RCM == engine->getParams().ordering ? "rcm" : "none", -1));
+			} else if ("processes" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewIntObj(engine->getParams().processes));
+			} else if ("partitioning" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(KernelLayout::PARTITIONING_GRAPH == engine->getParams().partitioning ? "graph" : "strips", -1));
+			} else if ("threads" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewIntObj(engine->getParams().threads));
+			} else if ("affinity" == param) {
+				Tcl_SetObjResult(interp, makeAffinity(interp, engine->getParams().affinity));
+			} else if ("huge-pages" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewBooleanObj(engine->getParams().hugePages ? 1 : 0));
+			} else if ("precision" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(Integrator::PRECISION_SINGLE == engine->getParams().precision ? "single" : "double", -1));
+			} else if ("sin-accuracy" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(formatAccuracy(engine->getParams().sinAccuracy), -1));
+			} else if ("async-tracing" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewBooleanObj(engine->getParams().asyncTracing ? 1 : 0));
 			} else {
-				throw WrongArgValue(interp, "step | delta");
+				throw WrongArgValue(interp, "step | delta | tile-size | ordering | processes | partitioning | threads | affinity | huge-pages | precision | sin-accuracy | async-tracing");
 			}
 
 			return TCL_OK;
@@ -153,13 +176,122 @@ namespace proc {
 				engine->getParams().step = phlib::TclUtils::getDouble(interp, objv[1]);
 			} else if ("delta" == param) {
 				engine->getParams().delta = phlib::TclUtils::getDouble(interp, objv[1]);
+			} else if ("tile-size" == param) {
+				engine->getParams().tileSize = phlib::TclUtils::getUInt(interp, objv[1]);
+			} else if ("ordering" == param) {
+				engine->getParams().ordering = parseOrdering(interp, objv[1]);
+			} else if ("processes" == param) {
+				engine->getParams().processes = phlib::TclUtils::getUInt(interp, objv[1]);
+			} else if ("partitioning" == param) {
+				engine->getParams().partitioning = parsePartitioning(interp, objv[1]);
+			} else if ("threads" == param) {
+				engine->getParams().threads = phlib::TclUtils::getUInt(interp, objv[1]);
+			} else if ("affinity" == param) {
+				engine->getParams().affinity = parseAffinity(interp, objv[1]);
+			} else if ("huge-pages" == param) {
+				int value;
+				if (TCL_OK != Tcl_GetBooleanFromObj(interp, objv[1], &value)) {
+					throw WrongArgValue(interp, "boolean value");
+				}
+				engine->getParams().hugePages = 0 != value;
+			} else if ("sin-accuracy" == param) {
+				engine->getParams().sinAccuracy = parseAccuracy(interp, objv[1]);
+			} else if ("async-tracing" == param) {
+				int value;
+				if (TCL_OK != Tcl_GetBooleanFromObj(interp, objv[1], &value)) {
+					throw WrongArgValue(interp, "boolean value");
+				}
+				engine->getParams().asyncTracing = 0 != value;
 			} else {
-				throw WrongArgValue(interp, "step | delta");
+				throw WrongArgValue(interp, "step | delta | tile-size | ordering | processes | partitioning | threads | affinity | huge-pages | sin-accuracy | async-tracing");
 			}
 
 			return TCL_OK;
 		}
 
+		static KernelLayout::Ordering parseOrdering(Tcl_Interp * interp, Tcl_Obj* obj) {
+			const std::string value = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("none" == value) {
+				return KernelLayout::ORDERING_NONE;
+			} else if ("rcm" == value) {
+				return KernelLayout::ORDERING_RCM;
+			} else {
+				throw WrongArgValue(interp, "none | rcm");
+			}
+		}
+
+		static fast_math::Accuracy parseAccuracy(Tcl_Interp * interp, Tcl_Obj* obj) {
+			const std::string value = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("full" == value) {
+				return fast_math::ACCURACY_FULL;
+			} else if ("1e-10" == value) {
+				return fast_math::ACCURACY_1E10;
+			} else if ("1e-6" == value) {
+				return fast_math::ACCURACY_1E6;
+			} else {
+				throw WrongArgValue(interp, "full | 1e-10 | 1e-6");
+			}
+		}
+
+		static const char* formatAccuracy(fast_math::Accuracy const accuracy) {
+			switch (accuracy) {
+			case fast_math::ACCURACY_1E10:
+				return "1e-10";
+			case fast_math::ACCURACY_1E6:
+				return "1e-6";
+			default:
+				return "full";
+			}
+		}
+
+		static Integrator::Precision parsePrecision(Tcl_Interp * interp, Tcl_Obj* obj) {
+			const std::string value = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("double" == value) {
+				return Integrator::PRECISION_DOUBLE;
+			} else if ("single" == value) {
+				return Integrator::PRECISION_SINGLE;
+			} else {
+				throw WrongArgValue(interp, "double | single");
+			}
+		}
+
+		static KernelLayout::Partitioning parsePartitioning(Tcl_Interp * interp, Tcl_Obj* obj) {
+			const std::string value = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("strips" == value) {
+				return KernelLayout::PARTITIONING_STRIPS;
+			} else if ("graph" == value) {
+				return KernelLayout::PARTITIONING_GRAPH;
+			} else {
+				throw WrongArgValue(interp, "strips | graph");
+			}
+		}
+
+		static Integrator::AffinityVector parseAffinity(Tcl_Interp * interp, Tcl_Obj* obj) {
+			int objc;
+			Tcl_Obj** objv;
+			if (TCL_OK != Tcl_ListObjGetElements(interp, obj, &objc, &objv)) {
+				throw WrongArgValue(interp, "list of processor numbers");
+			}
+
+			Integrator::AffinityVector affinity;
+			for (int i = 0; i < objc; ++i) {
+				affinity.push_back(phlib::TclUtils::getUInt(interp, objv[i]));
+			}
+			return affinity;
+		}
+
+		static Tcl_Obj* makeAffinity(Tcl_Interp * interp, const Integrator::AffinityVector& affinity) {
+			Tcl_Obj* ret = Tcl_NewListObj(0, NULL);
+			for (Integrator::AffinityVector::const_iterator i = affinity.begin(), last = affinity.end(); i != last; ++i) {
+				Tcl_ListObjAppendElement(interp, ret, Tcl_NewIntObj(*i));
+			}
+			return ret;
+		}
+
 		int run(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
 			if (objc != 4)
 				throw WrongNumArgs(interp, 0, objv, "networkInst startTime endTime dt");
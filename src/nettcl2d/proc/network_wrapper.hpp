@@ -14,10 +14,15 @@
 #ifndef PROC_NETWORK_HPP_
 #define PROC_NETWORK_HPP_
 
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <sstream>
 #include <boost/shared_ptr.hpp>
 #include <boost/bind.hpp>
 #include <phlib/tclutils.h>
 #include "../calc/network.hpp"
+#include "../calc/flux_map.hpp"
 #include "populator_wrapper.hpp"
 #include "contact_wrapper.hpp"
 #include "circuit_wrapper.hpp"
@@ -62,8 +67,28 @@ namespace proc {
 					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::get));
 				}
 
+				else if ("get-array" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::getArray));
+				}
+
+				else if ("set-array" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::setArray));
+				}
+
+				else if ("randomize" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::randomize));
+				}
+
+				else if ("fill" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::fill));
+				}
+
+				else if ("flux-map" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::fluxMap));
+				}
+
 				else
-					throw WrongArgValue(interp, "create | exists | get");
+					throw WrongArgValue(interp, "create | exists | get | get-array | set-array | randomize | fill | flux-map");
 			} catch (WrongNumArgs& ex) {
 				throw WrongNumArgs(interp, 2 + ex.objc, objv, ex.message);
 			}
@@ -137,6 +162,258 @@ namespace proc {
 			return TCL_OK;
 		}
 
+		/*
+		 * Returns a field of all elements matching the expression as a list
+		 * of doubles or as a byte array of native doubles.
+		 */
+		int getArray(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 1 || objc > 3)
+				throw WrongNumArgs(interp, 0, objv, "field ?tagExpr? ?list | binary?");
+
+			const Network::Field field = parseField(interp, objv[0]);
+			const Network::IndexVector indices = buildIndices(field, objc > 1 ? Tcl_GetStringFromObj(objv[1], NULL) : "");
+			const bool binary = objc > 2 && parseBinary(interp, objv[2]);
+
+			if (binary) {
+				Tcl_Obj* const ret = Tcl_NewByteArrayObj(NULL, 0);
+				double* const values = reinterpret_cast<double*>(Tcl_SetByteArrayLength(ret, indices.size() * sizeof(double)));
+				for (std::size_t i = 0; i < indices.size(); ++i) {
+					values[i] = engine->getField(field, indices[i]);
+				}
+				Tcl_SetObjResult(interp, ret);
+			} else {
+				std::vector<Tcl_Obj*> values(indices.size());
+				for (std::size_t i = 0; i < indices.size(); ++i) {
+					values[i] = Tcl_NewDoubleObj(engine->getField(field, indices[i]));
+				}
+				Tcl_SetObjResult(interp, Tcl_NewListObj(values.size(), values.empty() ? NULL : &values[0]));
+			}
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Assigns a field of all elements matching the expression. Values are
+		 * a list of doubles or a byte array of native doubles, one value per
+		 * element.
+		 */
+		int setArray(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 2 || objc > 3)
+				throw WrongNumArgs(interp, 0, objv, "field values ?tagExpr?");
+
+			const Network::Field field = parseWritableField(interp, objv[0]);
+
+			const Network::IndexVector indices = buildIndices(field, objc > 2 ? Tcl_GetStringFromObj(objv[2], NULL) : "");
+
+			if (objv[1]->typePtr == Tcl_GetObjType("bytearray")) {
+				int length;
+				const unsigned char* const bytes = Tcl_GetByteArrayFromObj(objv[1], &length);
+				if (std::size_t(length) != indices.size() * sizeof(double))
+					throw WrongArgValue(interp, "byte array of one double per element");
+
+				for (std::size_t i = 0; i < indices.size(); ++i) {
+					double value;
+					std::memcpy(&value, bytes + i * sizeof(double), sizeof(double));
+					engine->setField(field, indices[i], value);
+				}
+			} else {
+				int length;
+				Tcl_Obj** elements;
+				if (TCL_OK != Tcl_ListObjGetElements(interp, objv[1], &length, &elements))
+					throw WrongArgValue(interp, "list of doubles");
+				if (std::size_t(length) != indices.size())
+					throw WrongArgValue(interp, "list of one value per element");
+
+				// parse everything first so a bad value leaves the network intact
+				std::vector<double> values(indices.size());
+				for (std::size_t i = 0; i < indices.size(); ++i) {
+					values[i] = phlib::TclUtils::getDouble(interp, elements[i]);
+				}
+
+				for (std::size_t i = 0; i < indices.size(); ++i) {
+					engine->setField(field, indices[i], values[i]);
+				}
+			}
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Assigns a field of all elements matching the expression with
+		 * numbers generated in order of element indices.
+		 */
+		int randomize(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 3)
+				throw WrongNumArgs(interp, 0, objv, "field tagExpr rngInst");
+
+			const Network::Field field = parseWritableField(interp, objv[0]);
+			const Network::IndexVector indices = buildIndices(field, Tcl_GetStringFromObj(objv[1], NULL));
+			AbstractRng& rng = *RngWrapper::validateArg(interp, objv[2])->engine;
+
+			std::vector<double> values(indices.size());
+			if (!values.empty()) {
+				rng.generate(&values[0], values.size());
+			}
+
+			for (std::size_t i = 0; i < indices.size(); ++i) {
+				engine->setField(field, indices[i], values[i]);
+			}
+
+			return TCL_OK;
+		}
+
+		int fill(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 3)
+				throw WrongNumArgs(interp, 0, objv, "field tagExpr value");
+
+			const Network::Field field = parseWritableField(interp, objv[0]);
+			const Network::IndexVector indices = buildIndices(field, Tcl_GetStringFromObj(objv[1], NULL));
+			const double value = phlib::TclUtils::getDouble(interp, objv[2]);
+
+			for (Network::IndexVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
+				engine->setField(field, *i, value);
+			}
+
+			return TCL_OK;
+		}
+
+		enum MapFormat {
+			MAP_FORMAT_MAP,
+			MAP_FORMAT_SLICES,
+			MAP_FORMAT_BINARY
+		};
+
+		/*
+		 * Writes circuit fluxes by circuit coordinates to a file, or returns
+		 * them if file name is empty. Text formats are gnuplot data files,
+		 * binary format is the matrix of native doubles row by row.
+		 * Returns "minX maxX minY maxY" when writing a file, and the same
+		 * list followed by the matrix in binary format otherwise.
+		 */
+		int fluxMap(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc > 2)
+				throw WrongNumArgs(interp, 0, objv, "?fileName? ?map | slices | binary?");
+
+			const std::string fileName = objc > 0 ? Tcl_GetStringFromObj(objv[0], NULL) : "";
+			const MapFormat format = objc > 1 ? parseMapFormat(interp, objv[1]) : MAP_FORMAT_MAP;
+			const FluxMap map(*engine);
+
+			Tcl_Obj* const extents = Tcl_NewListObj(0, NULL);
+			if (!map.isEmpty()) {
+				Tcl_ListObjAppendElement(interp, extents, Tcl_NewLongObj(map.getMinX()));
+				Tcl_ListObjAppendElement(interp, extents, Tcl_NewLongObj(map.getMaxX()));
+				Tcl_ListObjAppendElement(interp, extents, Tcl_NewLongObj(map.getMinY()));
+				Tcl_ListObjAppendElement(interp, extents, Tcl_NewLongObj(map.getMaxY()));
+			}
+
+			if (!fileName.empty()) {
+				std::ofstream f(fileName.c_str(), MAP_FORMAT_BINARY == format ? std::ios::out | std::ios::binary : std::ios::out);
+				if (!f.is_open())
+					throw WrongArgValue(interp, "name of a writable file");
+
+				writeFluxMap(f, map, format);
+				Tcl_SetObjResult(interp, extents);
+			} else if (MAP_FORMAT_BINARY == format) {
+				const std::vector<double>& values = map.getValues();
+				Tcl_ListObjAppendElement(interp, extents, Tcl_NewByteArrayObj(
+						reinterpret_cast<const unsigned char*>(values.empty() ? NULL : &values[0]),
+						values.size() * sizeof(double)));
+				Tcl_SetObjResult(interp, extents);
+			} else {
+				std::ostringstream s;
+				writeFluxMap(s, map, format);
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(s.str().c_str(), s.str().size()));
+			}
+
+			return TCL_OK;
+		}
+
+		static void writeFluxMap(std::ostream& s, const FluxMap& map, MapFormat const format) {
+			if (MAP_FORMAT_BINARY == format) {
+				const std::vector<double>& values = map.getValues();
+				if (!values.empty()) {
+					s.write(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(double));
+				}
+				return;
+			}
+
+			s << "# X\tY\tFlux\n";
+			char flux[TCL_DOUBLE_SPACE];
+			for (long y = map.getMinY(); y <= map.getMaxY(); ++y) {
+				for (long x = map.getMinX(); x <= map.getMaxX(); ++x) {
+					Tcl_PrintDouble(NULL, map(x, y), flux);
+					s << x << '\t' << y << '\t' << flux << '\n';
+					if (MAP_FORMAT_SLICES == format) {
+						s << x << '\t' << y << "\t0.0\n\n";
+					}
+				}
+				s << (MAP_FORMAT_SLICES == format ? "\n\n" : "\n");
+			}
+		}
+
+		static MapFormat parseMapFormat(Tcl_Interp * interp, Tcl_Obj* const obj) {
+			const std::string s = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("map" == s) {
+				return MAP_FORMAT_MAP;
+			} else if ("slices" == s) {
+				return MAP_FORMAT_SLICES;
+			} else if ("binary" == s) {
+				return MAP_FORMAT_BINARY;
+			} else {
+				throw WrongArgValue(interp, "map | slices | binary");
+			}
+		}
+
+		Network::IndexVector buildIndices(const Network::Field field, const std::string& tagExpr) const {
+			return Network::isCircuitField(field)
+				? engine->buildCircuitIndices(tagExpr)
+				: engine->buildContactIndices(tagExpr);
+		}
+
+		static Network::Field parseField(Tcl_Interp * interp, Tcl_Obj* const obj) {
+			const std::string s = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("beta" == s) {
+				return Network::FIELD_BETA;
+			} else if ("tau" == s) {
+				return Network::FIELD_TAU;
+			} else if ("v" == s) {
+				return Network::FIELD_V;
+			} else if ("z" == s) {
+				return Network::FIELD_Z;
+			} else if ("phase" == s) {
+				return Network::FIELD_PHASE;
+			} else if ("voltage" == s) {
+				return Network::FIELD_VOLTAGE;
+			} else if ("square" == s) {
+				return Network::FIELD_SQUARE;
+			} else if ("flux" == s) {
+				return Network::FIELD_FLUX;
+			} else {
+				throw WrongArgValue(interp, "beta | tau | v | z | phase | voltage | square | flux");
+			}
+		}
+
+		static Network::Field parseWritableField(Tcl_Interp * interp, Tcl_Obj* const obj) {
+			const Network::Field field = parseField(interp, obj);
+			if (Network::isReadOnlyField(field))
+				throw WrongArgValue(interp, "beta | tau | v | z | phase | voltage | square");
+			return field;
+		}
+
+		static bool parseBinary(Tcl_Interp * interp, Tcl_Obj* const obj) {
+			const std::string s = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("list" == s) {
+				return false;
+			} else if ("binary" == s) {
+				return true;
+			} else {
+				throw WrongArgValue(interp, "list | binary");
+			}
+		}
+
 		template <typename IndexBuilder, typename ElementCreator>
 		Tcl_Obj* makeList(Tcl_Interp * interp, int objc, Tcl_Obj* const objv[], IndexBuilder builder, ElementCreator creator) {
 			Tcl_Obj *ret = Tcl_NewListObj(0, NULL);
@@ -29,14 +29,22 @@ namespace proc {
 
 		TagableWrapper(const TagableWrapper& src) {}
 
-		virtual Tagable& tagable() = 0;
+		virtual const Tagable& tagable() = 0;
+
+		virtual std::string prop(const std::string& name) = 0;
+
+		virtual bool match(const std::string& expr) = 0;
+
+		virtual void tag(const std::string& name) = 0;
+
+		virtual void untag(const std::string& name) = 0;
 
 		Tcl_Obj* getTagsObj(Tcl_Interp * interp) {
 			Tcl_Obj* ret = Tcl_NewListObj(0, NULL);
-			Tagable& t = tagable();
+			const Tagable::TagNameVector tags = tagable().getTags();
 
 			for (
-					Contact::const_tag_iterator i = t.getTags().begin(), last = t.getTags().end();
+					Tagable::const_tag_iterator i = tags.begin(), last = tags.end();
 					i != last; ++i) {
 				Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj(i->c_str(), -1));
 			}
@@ -100,7 +108,7 @@ namespace proc {
 			if (objc != 1)
 				throw WrongNumArgs(interp, 0, objv, "tag");
 
-			tagable().addTag(Tcl_GetStringFromObj(objv[0], NULL));
+			tag(Tcl_GetStringFromObj(objv[0], NULL));
 
 			return TCL_OK;
 		}
@@ -109,7 +117,7 @@ namespace proc {
 			if (objc != 1)
 				throw WrongNumArgs(interp, 0, objv, "tag");
 
-			tagable().removeTag(Tcl_GetStringFromObj(objv[0], NULL));
+			untag(Tcl_GetStringFromObj(objv[0], NULL));
 
 			return TCL_OK;
 		}
@@ -118,7 +126,7 @@ namespace proc {
 			if (objc != 1)
 				throw WrongNumArgs(interp, 0, objv, "propName");
 
-			Tcl_SetObjResult(interp, Tcl_NewStringObj(tagable().getProp(Tcl_GetStringFromObj(objv[0], NULL)).c_str(), -1));
+			Tcl_SetObjResult(interp, Tcl_NewStringObj(prop(Tcl_GetStringFromObj(objv[0], NULL)).c_str(), -1));
 
 			return TCL_OK;
 		}
@@ -128,7 +136,7 @@ namespace proc {
 				throw WrongNumArgs(interp, 0, objv, "expr");
 
 			Tcl_SetObjResult(interp, Tcl_NewIntObj(
-				tagable().matches(Tcl_GetStringFromObj(objv[0], NULL)) ? 1 : 0));
+				match(Tcl_GetStringFromObj(objv[0], NULL)) ? 1 : 0));
 			return TCL_OK;
 		}
 
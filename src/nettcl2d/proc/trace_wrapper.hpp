@@ -0,0 +1,293 @@
+/*
+ * proc/trace_wrapper.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef PROC_TRACE_WRAPPER_HPP_
+#define PROC_TRACE_WRAPPER_HPP_
+
+#include <algorithm>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include "wrapper.hpp"
+#include "../calc/trace_file.hpp"
+
+namespace proc {
+
+	namespace type {
+		extern const char* trace;
+	}
+
+	/*
+	 * Reads binary trace files written by tracers.
+	 */
+	class TraceWrapper : public Wrapper<&type::trace> {
+
+		typedef Wrapper<&type::trace> Base;
+
+		// column index standing for the time
+		static const std::size_t TIME_COLUMN = ~std::size_t(0);
+
+		// copies one column of scanned records
+		struct ColumnReader {
+			std::size_t column;
+			double* out;
+
+			void operator()(double const time, const TraceFile::Values& values) {
+				*out++ = TIME_COLUMN == column ? time : values[column];
+			}
+		};
+
+		// copies scanned records, the time followed by values of all columns
+		struct RecordReader {
+			std::size_t numOfColumns;
+			double* out;
+
+			void operator()(double const time, const TraceFile::Values& values) {
+				*out++ = time;
+				for (std::size_t j = 0; j < numOfColumns; ++j) {
+					*out++ = values[j];
+				}
+			}
+		};
+
+		explicit TraceWrapper() {}
+
+		virtual Base* clone() const {
+			return 0;
+		}
+
+		static int doMain(ClientData clientData, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			return process(clientData, interp, objc, objv, main);
+		}
+
+		static int main(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 2)
+				throw WrongNumArgs(interp, 1, objv, "command");
+
+			const std::string cmd = Tcl_GetStringFromObj(objv[1], NULL);
+
+			try {
+				if ("info" == cmd) {
+					return info(interp, objc - 2, objv + 2);
+				}
+
+				else if ("read" == cmd) {
+					return read(interp, objc - 2, objv + 2);
+				}
+
+				else if ("slice" == cmd) {
+					return slice(interp, objc - 2, objv + 2);
+				}
+
+				else
+					throw WrongArgValue(interp, "info | read | slice");
+			} catch (WrongNumArgs& ex) {
+				throw WrongNumArgs(interp, 2 + ex.objc, objv, ex.message);
+			}
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Returns a description of the file as a list of names and values.
+		 */
+		static int info(Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 1)
+				throw WrongNumArgs(interp, 0, objv, "fileName");
+
+			boost::scoped_ptr<TraceFile> file(openFile(interp, objv[0]));
+
+			Tcl_Obj* const columns = Tcl_NewListObj(0, NULL);
+			for (std::vector<std::string>::const_iterator i = file->getColumns().begin(), last = file->getColumns().end(); i != last; ++i) {
+				Tcl_ListObjAppendElement(interp, columns, Tcl_NewStringObj(i->c_str(), -1));
+			}
+
+			Tcl_Obj* const ret = Tcl_NewListObj(0, NULL);
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj("type", -1));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj(file->getType().c_str(), -1));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj("format", -1));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj(formatName(*file), -1));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj("start-time", -1));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewDoubleObj(file->getStartTime()));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj("interval", -1));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewDoubleObj(file->getInterval()));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj("records", -1));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewLongObj(file->getNumOfRecords()));
+			Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj("columns", -1));
+			Tcl_ListObjAppendElement(interp, ret, columns);
+			Tcl_SetObjResult(interp, ret);
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Returns values of one column in a range of records. The column is
+		 * given by its name, by its position among value columns, or as
+		 * "time".
+		 */
+		static int read(Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 2 || objc > 5)
+				throw WrongNumArgs(interp, 0, objv, "fileName column ?first? ?count? ?list | binary?");
+
+			boost::scoped_ptr<TraceFile> file(openFile(interp, objv[0]));
+			const std::size_t column = parseColumn(interp, *file, objv[1]);
+			std::size_t first, count;
+			parseRange(interp, *file, objc - 2, objv + 2, first, count);
+			const bool binary = objc > 4 && parseBinary(interp, objv[4]);
+
+			if (binary) {
+				Tcl_Obj* const ret = Tcl_NewByteArrayObj(NULL, 0);
+				ColumnReader reader = {column, reinterpret_cast<double*>(Tcl_SetByteArrayLength(ret, count * sizeof(double)))};
+				scanInto(interp, *file, first, count, reader, ret);
+			} else {
+				std::vector<double> buffer(count);
+				ColumnReader reader = {column, buffer.empty() ? NULL : &buffer[0]};
+				scan(interp, *file, first, count, reader);
+
+				std::vector<Tcl_Obj*> values(count);
+				for (std::size_t i = 0; i < count; ++i) {
+					values[i] = Tcl_NewDoubleObj(buffer[i]);
+				}
+				Tcl_SetObjResult(interp, Tcl_NewListObj(values.size(), values.empty() ? NULL : &values[0]));
+			}
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Returns a range of records, every one is the time followed by
+		 * values of all columns. Binary result holds records one after
+		 * another.
+		 */
+		static int slice(Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 1 || objc > 4)
+				throw WrongNumArgs(interp, 0, objv, "fileName ?first? ?count? ?list | binary?");
+
+			boost::scoped_ptr<TraceFile> file(openFile(interp, objv[0]));
+			std::size_t first, count;
+			parseRange(interp, *file, objc - 1, objv + 1, first, count);
+			const bool binary = objc > 3 && parseBinary(interp, objv[3]);
+			const std::size_t numOfColumns = file->getColumns().size();
+
+			if (binary) {
+				Tcl_Obj* const ret = Tcl_NewByteArrayObj(NULL, 0);
+				RecordReader reader = {numOfColumns, reinterpret_cast<double*>(Tcl_SetByteArrayLength(ret, count * (numOfColumns + 1) * sizeof(double)))};
+				scanInto(interp, *file, first, count, reader, ret);
+			} else {
+				std::vector<double> buffer(count * (numOfColumns + 1));
+				RecordReader reader = {numOfColumns, buffer.empty() ? NULL : &buffer[0]};
+				scan(interp, *file, first, count, reader);
+
+				std::vector<Tcl_Obj*> records(count), values(numOfColumns + 1);
+				for (std::size_t i = 0; i < count; ++i) {
+					for (std::size_t j = 0; j <= numOfColumns; ++j) {
+						values[j] = Tcl_NewDoubleObj(buffer[i * (numOfColumns + 1) + j]);
+					}
+					records[i] = Tcl_NewListObj(values.size(), &values[0]);
+				}
+				Tcl_SetObjResult(interp, Tcl_NewListObj(records.size(), records.empty() ? NULL : &records[0]));
+			}
+
+			return TCL_OK;
+		}
+
+		static TraceFile* openFile(Tcl_Interp * interp, Tcl_Obj* const obj) {
+			try {
+				return new TraceFile(Tcl_GetStringFromObj(obj, NULL));
+			} catch (TraceFile::FormatException&) {
+				throw WrongArgValue(interp, "name of a binary trace file");
+			}
+		}
+
+		template <typename Reader>
+		static void scan(Tcl_Interp * interp, const TraceFile& file, std::size_t const first, std::size_t const count, Reader& reader) {
+			try {
+				file.scan(first, count, reader);
+			} catch (TraceFile::FormatException&) {
+				throw WrongArgValue(interp, "uncorrupted binary trace file");
+			}
+		}
+
+		// scans into the result object, which is released if the scan fails
+		template <typename Reader>
+		static void scanInto(Tcl_Interp * interp, const TraceFile& file, std::size_t const first, std::size_t const count, Reader& reader, Tcl_Obj* const ret) {
+			Tcl_IncrRefCount(ret);
+			try {
+				scan(interp, file, first, count, reader);
+			} catch (...) {
+				Tcl_DecrRefCount(ret);
+				throw;
+			}
+			Tcl_SetObjResult(interp, ret);
+			Tcl_DecrRefCount(ret);
+		}
+
+		static std::size_t parseColumn(Tcl_Interp * interp, const TraceFile& file, Tcl_Obj* const obj) {
+			const std::string s = Tcl_GetStringFromObj(obj, NULL);
+			if ("time" == s) {
+				return TIME_COLUMN;
+			}
+
+			const std::size_t column = file.findColumn(s);
+			if (TraceFile::NOT_FOUND != column) {
+				return column;
+			}
+
+			long position;
+			if (TCL_OK == Tcl_GetLongFromObj(NULL, obj, &position) && position >= 0 && static_cast<std::size_t>(position) < file.getColumns().size()) {
+				return position;
+			}
+
+			throw WrongArgValue(interp, "time, column name or column position");
+		}
+
+		static void parseRange(Tcl_Interp * interp, const TraceFile& file, int objc, Tcl_Obj * CONST objv[], std::size_t& first, std::size_t& count) {
+			const std::size_t numOfRecords = file.getNumOfRecords();
+
+			first = objc > 0 ? std::min<std::size_t>(phlib::TclUtils::getUInt(interp, objv[0]), numOfRecords) : 0;
+			count = numOfRecords - first;
+			if (objc > 1) {
+				count = std::min<std::size_t>(phlib::TclUtils::getUInt(interp, objv[1]), count);
+			}
+		}
+
+		static bool parseBinary(Tcl_Interp * interp, Tcl_Obj* const obj) {
+			const std::string s = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("list" == s) {
+				return false;
+			} else if ("binary" == s) {
+				return true;
+			} else {
+				throw WrongArgValue(interp, "list | binary");
+			}
+		}
+
+		static const char* formatName(const TraceFile& file) {
+			if (sizeof(float) == file.getValueSize()) {
+				return file.isCompressed() ? "xor32" : "float32";
+			} else {
+				return file.isCompressed() ? "xor64" : "float64";
+			}
+		}
+
+	public:
+
+		static void registerCommands(Tcl_Interp * interp) {
+			registerCommand(interp, doMain);
+		}
+
+	};
+
+}
+
+#endif /* PROC_TRACE_WRAPPER_HPP_ */
@@ -24,6 +24,7 @@
 #include "../tracer/flux.hpp"
 #include "../tracer/phase_diff.hpp"
 #include "../tracer/phase.hpp"
+#include "../tracer/memory.hpp"
 
 namespace proc {
 
@@ -46,7 +47,7 @@ namespace proc {
 			return process(clientData, interp, objc, objv, main);
 		}
 
-		static int main(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+		static int main(ClientData clientData, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
 			if (objc < 2)
 				throw WrongNumArgs(interp, 1, objv, "command");
 
@@ -61,8 +62,12 @@ namespace proc {
 					return exists(interp, objc - 2, objv + 2);
 				}
 
+				else if ("get" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&TracerWrapper::get));
+				}
+
 				else
-					throw WrongArgValue(interp, "create | exists");
+					throw WrongArgValue(interp, "create | exists | get");
 			} catch (WrongNumArgs& ex) {
 				throw WrongNumArgs(interp, 2 + ex.objc, objv, ex.message);
 			}
@@ -108,8 +113,12 @@ namespace proc {
 				tracer = makeIndexTracer<tracer::Phase>(interp, objc, objv);
 			}
 
+			else if ("memory" == tracerType) {
+				tracer = makeMemoryTracer(interp, objc, objv);
+			}
+
 			else
-				throw WrongArgValue(interp, "null | avg-voltage | voltage | avg-flux | flux | phase | phase-diff");
+				throw WrongArgValue(interp, "null | avg-voltage | voltage | avg-flux | flux | phase | phase-diff | memory");
 
 			// instantiate new TCL object
 			Tcl_Obj* const w = Tcl_NewObj();
@@ -122,8 +131,8 @@ namespace proc {
 
 		template <typename Tracer>
 		static Tracer* makeTagableTracer(Tcl_Interp * interp, int objc, Tcl_Obj* const objv[]) {
-			if (objc > 6)
-				throw WrongNumArgs(interp, 1, objv, "?fileName? ?interval? ?startTime? ?precision? ?tagExpr?");
+			if (objc > 7)
+				throw WrongNumArgs(interp, 1, objv, "?fileName? ?interval? ?startTime? ?precision? ?tagExpr? ?format?");
 
 			typename Tracer::Params params;
 
@@ -150,13 +159,17 @@ namespace proc {
 				params.tagExpr = Tcl_GetStringFromObj(objv[5], NULL);
 			}
 
+			if (objc > 6) {
+				params.format = parseFormat(interp, objv[6]);
+			}
+
 			return new Tracer(params);
 		}
 
 		template <typename Tracer>
 		static Tracer* makeIndexTracer(Tcl_Interp * interp, int objc, Tcl_Obj* const objv[]) {
-			if (objc > 6)
-				throw WrongNumArgs(interp, 1, objv, "?fileNameFormat? ?interval? ?startTime? ?precision? ?tagExpr?");
+			if (objc > 8)
+				throw WrongNumArgs(interp, 1, objv, "?fileNameFormat? ?interval? ?startTime? ?precision? ?tagExpr? ?layout? ?format?");
 
 			typedef typename Tracer::Params Params;
 			Params params;
@@ -184,12 +197,31 @@ namespace proc {
 				params.tagExpr = Tcl_GetStringFromObj(objv[5], NULL);
 			}
 
+			if (objc > 6) {
+				const std::string layout = Tcl_GetStringFromObj(objv[6], NULL);
+				if ("files" == layout) {
+					params.layout = Tracer::LAYOUT_FILES;
+				} else if ("columns" == layout) {
+					params.layout = Tracer::LAYOUT_COLUMNS;
+				} else if ("rows" == layout) {
+					params.layout = Tracer::LAYOUT_ROWS;
+				} else {
+					throw WrongArgValue(interp, "files | columns | rows");
+				}
+			}
+
+			if (objc > 7) {
+				params.format = parseFormat(interp, objv[7]);
+				if (Tracer::LAYOUT_ROWS == params.layout && tracer::RecordWriter::FORMAT_TEXT != params.format)
+					throw WrongArgValue(interp, "text format for rows layout");
+			}
+
 			return new Tracer(params);
 		}
 
 		static tracer::PhaseDifference* makePhaseDiffTracer(Tcl_Interp * interp, int objc, Tcl_Obj* const objv[]) {
-			if (objc > 7)
-				throw WrongNumArgs(interp, 1, objv, "?fileName? ?interval? ?startTime? ?precision? ?tagExpr1? ?tagExpr2?");
+			if (objc > 8)
+				throw WrongNumArgs(interp, 1, objv, "?fileName? ?interval? ?startTime? ?precision? ?tagExpr1? ?tagExpr2? ?format?");
 
 			tracer::PhaseDifference::Params params;
 
@@ -220,9 +252,134 @@ namespace proc {
 				params.tagExpr2 = Tcl_GetStringFromObj(objv[6], NULL);
 			}
 
+			if (objc > 7) {
+				params.format = parseFormat(interp, objv[7]);
+			}
+
 			return new tracer::PhaseDifference(params);
 		}
 
+		static tracer::Memory* makeMemoryTracer(Tcl_Interp * interp, int objc, Tcl_Obj* const objv[]) {
+			if (objc < 2 || objc > 6)
+				throw WrongNumArgs(interp, 1, objv, "quantity ?capacity? ?interval? ?startTime? ?tagExpr?");
+
+			tracer::Memory::Params params;
+
+			if (objc > 2) {
+				params.capacity = phlib::TclUtils::getUInt(interp, objv[2]);
+				if (0 == params.capacity)
+					throw WrongArgValue(interp, "positive capacity");
+			}
+
+			if (objc > 3) {
+				params.interval = phlib::TclUtils::getDouble(interp, objv[3]);
+			}
+
+			if (objc > 4) {
+				params.startTime = phlib::TclUtils::getDouble(interp, objv[4]);
+			}
+
+			const std::string tagExpr = objc > 5 ? Tcl_GetStringFromObj(objv[5], NULL) : "";
+			const std::string quantity = Tcl_GetStringFromObj(objv[1], NULL);
+			tracer::Sampler* sampler;
+
+			if ("voltage" == quantity) {
+				sampler = new tracer::IndexSampler<tracer::VoltageWorker>(tagExpr);
+			} else if ("flux" == quantity) {
+				sampler = new tracer::IndexSampler<tracer::FluxWorker, false>(tagExpr);
+			} else if ("phase" == quantity) {
+				sampler = new tracer::IndexSampler<tracer::PhaseWorker>(tagExpr);
+			} else if ("avg-voltage" == quantity) {
+				sampler = new tracer::AverageSampler<tracer::VoltageWorker>(tagExpr);
+			} else if ("avg-flux" == quantity) {
+				sampler = new tracer::AverageSampler<tracer::FluxWorker, false>(tagExpr);
+			} else {
+				throw WrongArgValue(interp, "voltage | flux | phase | avg-voltage | avg-flux");
+			}
+
+			return new tracer::Memory(params, sampler);
+		}
+
+		int get(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 1)
+				throw WrongNumArgs(interp, 0, objv, "parameter");
+
+			const tracer::Memory* const memory = dynamic_cast<const tracer::Memory*>(engine.get());
+			if (!memory)
+				throw WrongArgValue(interp, "memory tracer instance");
+
+			const std::string param = Tcl_GetStringFromObj(objv[0], NULL);
+
+			if ("data" == param) {
+				if (objc > 3)
+					throw WrongNumArgs(interp, 0, objv, "data ?count? ?list | binary?");
+
+				const std::size_t count = std::min<std::size_t>(objc > 1 ? phlib::TclUtils::getUInt(interp, objv[1]) : memory->getSize(), memory->getSize());
+				const std::size_t recordSize = memory->getRecordSize();
+				bool binary = false;
+				if (objc > 2) {
+					const std::string s = Tcl_GetStringFromObj(objv[2], NULL);
+					if ("binary" == s) {
+						binary = true;
+					} else if ("list" != s) {
+						throw WrongArgValue(interp, "list | binary");
+					}
+				}
+
+				if (binary) {
+					Tcl_Obj* const ret = Tcl_NewByteArrayObj(NULL, 0);
+					memory->copy(count, reinterpret_cast<double*>(Tcl_SetByteArrayLength(ret, count * recordSize * sizeof(double))));
+					Tcl_SetObjResult(interp, ret);
+				} else {
+					std::vector<double> buffer(count * recordSize);
+					if (!buffer.empty()) {
+						memory->copy(count, &buffer[0]);
+					}
+
+					std::vector<Tcl_Obj*> records(count), values(recordSize);
+					for (std::size_t i = 0; i < count; ++i) {
+						for (std::size_t j = 0; j < recordSize; ++j) {
+							values[j] = Tcl_NewDoubleObj(buffer[i * recordSize + j]);
+						}
+						records[i] = Tcl_NewListObj(values.size(), &values[0]);
+					}
+					Tcl_SetObjResult(interp, Tcl_NewListObj(records.size(), records.empty() ? NULL : &records[0]));
+				}
+			} else if ("columns" == param) {
+				Tcl_Obj* const ret = Tcl_NewListObj(0, NULL);
+				for (std::vector<std::string>::const_iterator i = memory->getColumns().begin(), last = memory->getColumns().end(); i != last; ++i) {
+					Tcl_ListObjAppendElement(interp, ret, Tcl_NewStringObj(i->c_str(), -1));
+				}
+				Tcl_SetObjResult(interp, ret);
+			} else if ("size" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewLongObj(memory->getSize()));
+			} else if ("capacity" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewLongObj(memory->getCapacity()));
+			} else {
+				throw WrongArgValue(interp, "data | columns | size | capacity");
+			}
+
+			return TCL_OK;
+		}
+
+		static tracer::RecordWriter::Format parseFormat(Tcl_Interp * interp, Tcl_Obj* const obj) {
+			const std::string s = Tcl_GetStringFromObj(obj, NULL);
+
+			if ("text" == s) {
+				return tracer::RecordWriter::FORMAT_TEXT;
+			} else if ("float64" == s) {
+				return tracer::RecordWriter::FORMAT_FLOAT64;
+			} else if ("float32" == s) {
+				return tracer::RecordWriter::FORMAT_FLOAT32;
+			} else if ("xor64" == s) {
+				return tracer::RecordWriter::FORMAT_XOR64;
+			} else if ("xor32" == s) {
+				return tracer::RecordWriter::FORMAT_XOR32;
+			} else {
+				throw WrongArgValue(interp, "text | float64 | float32 | xor64 | xor32");
+			}
+		}
+
 	public:
 
 		boost::shared_ptr<AbstractTracer> engine;
@@ -24,6 +24,12 @@ namespace rng {
 			return value;
 		}
 
+		virtual void doGenerate(double values[], std::size_t const count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				values[i] = value;
+			}
+		}
+
 		virtual void doSeed(long seedValue) {
 		}
 
@@ -28,6 +28,12 @@ namespace rng {
 			return distr(generator);
 		}
 
+		virtual void doGenerate(double values[], std::size_t const count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				values[i] = distr(generator);
+			}
+		}
+
 		virtual void doSeed(long seedValue) {
 			generator.seed(static_cast<uint64_t>(seedValue));
 		}
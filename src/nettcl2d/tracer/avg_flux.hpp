@@ -20,13 +20,17 @@ namespace tracer {
 
 	class AverageFlux : public CircuitTracer {
 
-		virtual void doTrace(const Network& network, double const time, std::ostream& s) {
+		virtual void doTrace(const Network& network, double const time, std::vector<double>& values) {
 			const Statistics stat = calcStat(network);
-			s << stat.getMean();
+			values[0] = stat.getMean();
 		}
 
-		virtual void writeHeader(std::ostream& s) {
-			s << "# time\t<flux>\n";
+		virtual const char* getType() const {
+			return "avg-flux";
+		}
+
+		virtual void getColumns(std::vector<std::string>& columns) const {
+			columns.push_back("<flux>");
 		}
 
 	public:
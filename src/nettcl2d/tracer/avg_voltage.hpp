@@ -28,13 +28,17 @@ namespace tracer {
 
 	class AverageVoltage : public ContactTracer {
 
-		virtual void doTrace(const Network& network, double const time, std::ostream& s) {
+		virtual void doTrace(const Network& network, double const time, std::vector<double>& values) {
 			const Statistics stat = calcStat(network);
-			s << stat.getMean();
+			values[0] = stat.getMean();
 		}
 
-		virtual void writeHeader(std::ostream& s) {
-			s << "# time\t<voltage>\n";
+		virtual const char* getType() const {
+			return "avg-voltage";
+		}
+
+		virtual void getColumns(std::vector<std::string>& columns) const {
+			columns.push_back("<voltage>");
 		}
 
 	public:
@@ -51,7 +55,7 @@ namespace tracer {
 			Statistics stat;
 
 			for (Network::IndexVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
-				stat.accum(network.contact(*i).voltage);
+				stat.accum(network.voltage(*i));
 			}
 
 			return stat;
@@ -16,6 +16,7 @@
 
 #include <math.h>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <iomanip>
 #include <boost/scoped_ptr.hpp>
@@ -23,13 +24,15 @@
 #include "../calc/abstract_tracer.hpp"
 #include "../util/statistics.hpp"
 #include "time_tracer.hpp"
+#include "record_writer.hpp"
 
 namespace tracer {
 
 	class FileIteration : public AbstractTracer, TimeTracer {
 
-		virtual void doTrace(const Network& network, double const time, std::ostream&) = 0;
-		virtual void writeHeader(std::ostream& s) {}
+		virtual void doTrace(const Network& network, double const time, std::vector<double>& values) = 0;
+		virtual const char* getType() const = 0;
+		virtual void getColumns(std::vector<std::string>& columns) const = 0;
 
 	protected:
 
@@ -45,12 +48,9 @@ namespace tracer {
 		}
 
 		virtual void doAfterIteration(const Network& network, double const time) {
-			if (s && params->startTime <= time && nextTime <= time) {
-				*s	<< std::fixed << std::setprecision(timePrecision) << time
-					<< std::scientific << std::setprecision(params->precision)
-					<< '\t';
-				doTrace(network, time, *s);
-				*s << '\n';
+			if (writer.isOpen() && params->startTime <= time && nextTime <= time) {
+				doTrace(network, time, values);
+				writer.write(time, values.empty() ? NULL : &values[0]);
 				nextTime = time + params->interval;
 			}
 		}
@@ -60,39 +60,42 @@ namespace tracer {
 			double interval;
 			double startTime;
 			unsigned precision;
+			RecordWriter::Format format;
 
 			IterationParams(const char* fileName) :
 				fileName(fileName),
 				interval(0.0),
 				startTime(0.0),
-				precision(6) {}
+				precision(6),
+				format(RecordWriter::FORMAT_TEXT) {}
 
 		};
 
 		boost::scoped_ptr<const IterationParams> params;
 		double nextTime;
-		boost::scoped_ptr<phlib::TraceStream> s;
+		RecordWriter writer;
+		std::vector<double> values;
 
 		FileIteration(const IterationParams* p) : params(p), nextTime(0.0) {}
 
 		void open() {
 			if (!params->fileName.empty()) {
-				// open a file
-				s.reset(new phlib::TraceStream(params->fileName));
+				std::vector<std::string> columns;
+				getColumns(columns);
+				values.assign(columns.size(), 0.0);
 
-				if (s->is_open() && s->isHeaderRequired()) {
-					writeHeader(*s);
-				}
-				if (!s->is_open()) {
-					close();
-				} else {
-					*s << std::setprecision(params->precision);
+				// open a file
+				writer.setPrecision(timePrecision, params->precision);
+				writer.setTimeBase(params->startTime, params->interval);
+				writer.open(params->fileName, params->format, getType(), columns);
+				if (getAsyncWriter()) {
+					writer.attach(*getAsyncWriter());
 				}
 			}
 		}
 
 		void close() {
-			s.reset();
+			writer.close();
 		}
 
 	};
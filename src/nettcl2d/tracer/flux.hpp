@@ -20,17 +20,21 @@ namespace tracer {
 
 	struct FluxWorker {
 
-		void writeHeader(std::ostream& s, const Network::index_type index) const {
-			s << "# time\tflux[" << index << "]\n";
+		static const char* quantity() {
+			return "flux";
 		}
 
-		void trace(std::ostream& s, const Network& network, const Network::index_type index) const {
-			s << network.flux(index);
+		double value(const Network& network, const Network::index_type index) const {
+			return network.flux(index);
 		}
 
 		static const char* fileNameFormat() {
 			return "flux.%u";
 		}
+
+		static const char* fileName() {
+			return "flux.dat";
+		}
 	};
 
 	class Flux : public IndexTracer<FluxWorker, false> {
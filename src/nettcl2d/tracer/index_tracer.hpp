@@ -14,11 +14,19 @@
 #ifndef TRACER_INDEX_TRACER_HPP_
 #define TRACER_INDEX_TRACER_HPP_
 
+#include <stdlib.h>
+#include <unistd.h>
 #include <set>
+#include <sstream>
+#include <iomanip>
 #include <iterator>
+#include <stdexcept>
 #include <boost/scoped_ptr.hpp>
 #include <boost/bind.hpp>
 #include "null.hpp"
+#include "record_writer.hpp"
+#include "../calc/trace_file.hpp"
+#include "../calc/number_format.hpp"
 
 namespace tracer {
 
@@ -36,6 +44,25 @@ namespace tracer {
 		}
 	};
 
+	/*
+	 * Traces a quantity of every selected contact or circuit.
+	 *
+	 * Layout LAYOUT_FILES writes every index into its own file named by
+	 * fileNameFormat. LAYOUT_COLUMNS writes one file with a row per sample
+	 * and a column per index, LAYOUT_ROWS writes one file with a row per
+	 * index and a column per sample. Single file layouts use
+	 * fileNameFormat as a file name unless it contains a conversion, then
+	 * the default name of the worker is used.
+	 *
+	 * Rows layout writes samples by columns into a temporary binary file
+	 * next to the output and transposes it when the run is over, a chunk
+	 * of indices at a time, so memory does not grow with the length of
+	 * the run. Every run appends a block of rows headed by its own line of
+	 * times, blocks are separated by an empty line. Rows layout writes
+	 * text only, binary files are read by columns or by records equally
+	 * well. A run fails with std::runtime_error if its samples cannot be
+	 * kept in the temporary file.
+	 */
 	template <typename Worker, bool useContacts = true>
 	class IndexTracer : public Null, TimeTracer {
 
@@ -52,13 +79,28 @@ namespace tracer {
 
 		virtual void doAfterIteration(const Network& network, double const time) {
 			if (params.startTime <= time && nextTime <= time) {
-				std::for_each(entries.begin(), entries.end(), boost::bind(&Entry::trace, _1, &network, time));
+				switch (params.layout) {
+				case LAYOUT_FILES:
+					std::for_each(entries.begin(), entries.end(), boost::bind(&Entry::trace, _1, &network, time));
+					break;
+
+				case LAYOUT_COLUMNS:
+				case LAYOUT_ROWS:
+					traceColumns(network, time);
+					break;
+				}
 				nextTime = time + params.interval;
 			}
 		}
 
 	public:
 
+		enum Layout {
+			LAYOUT_FILES,
+			LAYOUT_COLUMNS,
+			LAYOUT_ROWS
+		};
+
 		struct Params {
 
 			typedef std::set<Network::index_type> IndexContainer;
@@ -68,12 +110,16 @@ namespace tracer {
 			double interval;
 			int precision;
 			std::string tagExpr;
+			Layout layout;
+			RecordWriter::Format format;
 
 			Params() :
 				fileNameFormat(Worker::fileNameFormat()),
 				startTime(0.0),
 				interval(0.0),
-				precision(6)
+				precision(6),
+				layout(LAYOUT_FILES),
+				format(RecordWriter::FORMAT_TEXT)
 			{}
 
 			std::string makeFileName(std::size_t index) const {
@@ -82,6 +128,10 @@ namespace tracer {
 				return buf;
 			}
 
+			std::string makeFileName() const {
+				return std::string::npos == fileNameFormat.find('%') ? fileNameFormat : Worker::fileName();
+			}
+
 		};
 
 		IndexTracer(const Params& params) :
@@ -92,32 +142,25 @@ namespace tracer {
 
 		struct Entry {
 			Network::index_type index;
-			boost::scoped_ptr<phlib::TraceStream> s;
-			int timePrecision;
-			int precision;
+			RecordWriter writer;
 			Worker worker;
 
 			Entry(const Network::index_type index, const Params& params, const int timePrecision) :
-					index(index),
-					s(new phlib::TraceStream(params.makeFileName(index))),
-					timePrecision(timePrecision),
-					precision(params.precision) {
+					index(index) {
 
-				if (s->is_open() && s->isHeaderRequired()) {
-					worker.writeHeader(*s, index);
-				}
-				if (!s->is_open()) {
-					close();
-				}
+				writer.setPrecision(timePrecision, params.precision);
+				writer.setTimeBase(params.startTime, params.interval);
+				writer.open(params.makeFileName(index), params.format, Worker::quantity(), std::vector<std::string>(1, makeColumnName(index)));
+			}
+
+			void attach(AsyncWriter* async) {
+				writer.attach(*async);
 			}
 
 			void trace(const Network* source, const double time) {
-				if (s) {
-					*s	<< std::fixed << std::setprecision(timePrecision) << time
-						<< std::scientific << std::setprecision(precision)
-						<< '\t';
-					worker.trace(*s, *source, index);
-					*s << '\n';
+				if (writer.isOpen()) {
+					const double value = worker.value(*source, index);
+					writer.write(time, &value);
 				}
 			}
 
@@ -125,58 +168,184 @@ namespace tracer {
 			Entry(const Entry& src);
 			Entry& operator=(const Entry& src);
 
-			void close() {
-				s.reset();
-			}
-
 		};
 
 		typedef boost::shared_ptr<Entry> EntryPointer;
 		typedef std::vector<EntryPointer> EntryVector;
 
-		struct IndexGenerator {
-
-			IndexGenerator() : index(0) {}
-
-			Network::index_type operator()() {
-				return index++;
-			}
+		Params params;
+		double nextTime;
+		Worker worker;
+		Network::IndexVector indices;
 
-		private:
+		// LAYOUT_FILES
+		EntryVector entries;
 
-			Network::index_type index;
+		// LAYOUT_COLUMNS, LAYOUT_ROWS
+		RecordWriter writer;
+		std::vector<double> values;
 
-		};
+		// LAYOUT_ROWS, temporary file of samples by columns
+		std::string spillName;
 
-		Params params;
-		double nextTime;
-		EntryVector entries;
+		// doubles of samples transposed at once
+		static const std::size_t TRANSPOSE_SIZE = 4194304;
 
 		EntryPointer makeEntry(const Network::index_type index) const {
 			return EntryPointer(new Entry(index, params, timePrecision));
 		}
 
 		void open(const Network& source) {
-			// populate vector of node indices
-			Network::IndexVector indices;
-			if (!params.tagExpr.empty()) {
-				// tag expression is specified
-				indices = IndexBuilder<useContacts>::buildIndices(source, params.tagExpr);
+			// empty tag expression selects all network nodes
+			indices = IndexBuilder<useContacts>::buildIndices(source, params.tagExpr);
+
+			switch (params.layout) {
+			case LAYOUT_FILES:
+				// create trace streams
+				std::transform(
+					indices.begin(),
+					indices.end(),
+					std::back_insert_iterator<EntryVector>(entries),
+					boost::bind(&IndexTracer::makeEntry, this, _1));
+				if (getAsyncWriter()) {
+					std::for_each(entries.begin(), entries.end(), boost::bind(&Entry::attach, _1, getAsyncWriter()));
+				}
+				break;
+
+			case LAYOUT_COLUMNS:
+				openColumns(params.makeFileName(), params.format);
+				break;
+
+			case LAYOUT_ROWS:
+				{
+					// unique name, the writer appends to the empty file
+					std::string name = params.makeFileName() + ".XXXXXX";
+					const int fd = mkstemp(&name[0]);
+					if (fd < 0) {
+						throw std::runtime_error("cannot create temporary file for rows of " + params.makeFileName());
+					}
+					::close(fd);
+					spillName = name;
+					openColumns(spillName, RecordWriter::FORMAT_FLOAT64);
+					if (!writer.isOpen()) {
+						throw std::runtime_error("cannot open temporary file " + spillName);
+					}
+				}
+				break;
+			}
+		}
+
+		void openColumns(const std::string& fileName, RecordWriter::Format const format) {
+			std::vector<std::string> columns;
+			for (Network::IndexVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
+				columns.push_back(makeColumnName(*i));
+			}
+			values.resize(indices.size());
+
+			writer.setPrecision(timePrecision, params.precision);
+			writer.setTimeBase(params.startTime, params.interval);
+			writer.open(fileName, format, Worker::quantity(), columns);
+			if (getAsyncWriter()) {
+				writer.attach(*getAsyncWriter());
+			}
+		}
+
+		void traceColumns(const Network& network, double const time) {
+			if (writer.isOpen()) {
+				for (std::size_t i = 0; i < indices.size(); ++i) {
+					values[i] = worker.value(network, indices[i]);
+				}
+				writer.write(time, values.empty() ? NULL : &values[0]);
+			}
+		}
+
+		static std::string makeColumnName(const Network::index_type index) {
+			std::stringstream s;
+			s << Worker::quantity() << '[' << index << ']';
+			return s.str();
+		}
+
+		// transposes samples of the temporary file
+		void writeRows(const TraceFile& samples) {
+			const std::size_t numOfSamples = samples.getNumOfRecords();
+			if (0 == numOfSamples) {
+				return;
+			}
+
+			phlib::TraceStream f(params.makeFileName());
+			if (!f.is_open()) {
+				return;
+			}
+
+			if (!f.isHeaderRequired()) {
+				f << '\n';
+			}
+			f << "# " << Worker::quantity() << "\\time";
+			for (std::size_t j = 0; j < numOfSamples; ++j) {
+				writeFixed(f, samples.time(j), timePrecision);
+			}
+			f << '\n';
+
+			const std::size_t chunk = std::max<std::size_t>(1, TRANSPOSE_SIZE / numOfSamples);
+			std::vector<double> rows;
+			for (std::size_t first = 0; first < indices.size(); first += chunk) {
+				const std::size_t count = std::min(chunk, indices.size() - first);
+				rows.resize(count * numOfSamples);
+				for (std::size_t j = 0; j < numOfSamples; ++j) {
+					for (std::size_t i = 0; i < count; ++i) {
+						rows[i * numOfSamples + j] = samples.value(j, first + i);
+					}
+				}
+
+				for (std::size_t i = 0; i < count; ++i) {
+					f << indices[first + i];
+					for (std::size_t j = 0; j < numOfSamples; ++j) {
+						writeScientific(f, rows[i * numOfSamples + j], params.precision);
+					}
+					f << '\n';
+				}
+			}
+		}
+
+		// numbers are formatted as RecordWriter formats text, a precision
+		// number_format does not support falls back to iostreams
+		static void writeFixed(std::ostream& f, double const value, int const precision) {
+			char buf[number_format::MAX_LENGTH + 1];
+			if (precision <= number_format::MAX_PRECISION) {
+				buf[0] = '\t';
+				f.write(buf, number_format::fixed(buf + 1, value, precision) - buf);
 			} else {
-				// trace all network nodes
-				std::generate_n(std::back_insert_iterator<Network::IndexVector>(indices), source.getNumOfContacts(), IndexGenerator());
+				f << '\t' << std::fixed << std::setprecision(precision) << value;
 			}
+		}
 
-			// create trace streams
-			std::transform(
-				indices.begin(),
-				indices.end(),
-				std::back_insert_iterator<EntryVector>(entries),
-				boost::bind(&IndexTracer::makeEntry, this, _1));
+		static void writeScientific(std::ostream& f, double const value, int const precision) {
+			char buf[number_format::MAX_LENGTH + 1];
+			if (precision <= number_format::MAX_PRECISION) {
+				buf[0] = '\t';
+				f.write(buf, number_format::scientific(buf + 1, value, precision) - buf);
+			} else {
+				f << '\t' << std::scientific << std::setprecision(precision) << value;
+			}
 		}
 
 		void close() {
 			entries.clear();
+			writer.close();
+
+			if (!spillName.empty()) {
+				const std::string name = spillName;
+				spillName.clear();
+
+				try {
+					const TraceFile samples(name);
+					writeRows(samples);
+				} catch (TraceFile::FormatException& ex) {
+					unlink(name.c_str());
+					throw std::runtime_error("samples for rows of " + params.makeFileName() + " are lost: " + ex.what());
+				}
+				unlink(name.c_str());
+			}
 		}
 	};
 
@@ -0,0 +1,202 @@
+/*
+ * tracer/memory.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef TRACER_MEMORY_HPP_
+#define TRACER_MEMORY_HPP_
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include "../calc/abstract_tracer.hpp"
+#include "../util/statistics.hpp"
+#include "index_tracer.hpp"
+
+namespace tracer {
+
+	/*
+	 * Source of the values a memory tracer keeps.
+	 */
+	class Sampler {
+	public:
+		virtual ~Sampler() {}
+
+		// selects network nodes and returns names of the values
+		virtual void open(const Network& network, std::vector<std::string>& columns) = 0;
+
+		virtual void sample(const Network& network, double values[]) const = 0;
+	};
+
+	/*
+	 * Quantity of every selected contact or circuit.
+	 */
+	template <typename Worker, bool useContacts = true>
+	class IndexSampler : public Sampler {
+	public:
+
+		explicit IndexSampler(const std::string& tagExpr) : tagExpr(tagExpr) {}
+
+		virtual void open(const Network& network, std::vector<std::string>& columns) {
+			indices = IndexBuilder<useContacts>::buildIndices(network, tagExpr);
+			for (Network::IndexVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
+				std::stringstream s;
+				s << Worker::quantity() << '[' << *i << ']';
+				columns.push_back(s.str());
+			}
+		}
+
+		virtual void sample(const Network& network, double values[]) const {
+			for (std::size_t i = 0; i < indices.size(); ++i) {
+				values[i] = worker.value(network, indices[i]);
+			}
+		}
+
+	private:
+
+		const std::string tagExpr;
+		Network::IndexVector indices;
+		Worker worker;
+
+	};
+
+	/*
+	 * Quantity averaged over selected contacts or circuits.
+	 */
+	template <typename Worker, bool useContacts = true>
+	class AverageSampler : public Sampler {
+	public:
+
+		explicit AverageSampler(const std::string& tagExpr) : tagExpr(tagExpr) {}
+
+		virtual void open(const Network& network, std::vector<std::string>& columns) {
+			indices = IndexBuilder<useContacts>::buildIndices(network, tagExpr);
+			columns.push_back(std::string("<") + Worker::quantity() + '>');
+		}
+
+		virtual void sample(const Network& network, double values[]) const {
+			Statistics stat;
+			for (Network::IndexVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
+				stat.accum(worker.value(network, *i));
+			}
+			values[0] = stat.getMean();
+		}
+
+	private:
+
+		const std::string tagExpr;
+		Network::IndexVector indices;
+		Worker worker;
+
+	};
+
+	/*
+	 * Keeps the latest records of a quantity in memory, a time and a
+	 * value of every column each. When capacity records are kept a new
+	 * record replaces the oldest one, so nothing is allocated during a
+	 * run. Records are kept after the run until the next one starts.
+	 */
+	class Memory : public AbstractTracer {
+
+		virtual void doBeforeRun(const Network& network, double const startTime, double const endTime, double const dt) {
+			columns.clear();
+			sampler->open(network, columns);
+			records.assign(params.capacity * getRecordSize(), 0.0);
+			first = 0;
+			size = 0;
+			nextTime = startTime;
+		}
+
+		virtual void doAfterRun(const Network& network) {}
+
+		virtual void doAfterIteration(const Network& network, double const time) {
+			if (params.startTime <= time && nextTime <= time) {
+				const std::size_t slot = first + size;
+				if (size < params.capacity) {
+					++size;
+				} else {
+					first = (first + 1) % params.capacity;
+				}
+
+				double* const p = &records[slot % params.capacity * getRecordSize()];
+				p[0] = time;
+				sampler->sample(network, p + 1);
+				nextTime = time + params.interval;
+			}
+		}
+
+	public:
+
+		struct Params {
+			std::size_t capacity;
+			double interval;
+			double startTime;
+
+			Params() :
+				capacity(4096),
+				interval(0.0),
+				startTime(0.0)
+			{}
+		};
+
+		// takes ownership of the sampler
+		Memory(const Params& params, Sampler* const sampler) :
+			params(params), sampler(sampler), first(0), size(0), nextTime(0.0) {}
+
+		const std::vector<std::string>& getColumns() const {
+			return columns;
+		}
+
+		std::size_t getCapacity() const {
+			return params.capacity;
+		}
+
+		std::size_t getSize() const {
+			return size;
+		}
+
+		// time and values of every column
+		std::size_t getRecordSize() const {
+			return columns.size() + 1;
+		}
+
+		/*
+		 * Copies the latest count records, the oldest one first.
+		 */
+		void copy(std::size_t count, double out[]) const {
+			count = std::min(count, size);
+			const std::size_t recordSize = getRecordSize();
+
+			for (std::size_t i = size - count; i < size; ++i, out += recordSize) {
+				std::memcpy(out, &records[(first + i) % params.capacity * recordSize], recordSize * sizeof(double));
+			}
+		}
+
+	private:
+
+		const Params params;
+		boost::scoped_ptr<Sampler> sampler;
+		std::vector<std::string> columns;
+
+		// ring of capacity records, size of them starting with first are kept
+		std::vector<double> records;
+		std::size_t first;
+		std::size_t size;
+		double nextTime;
+
+	};
+
+}
+
+#endif /* TRACER_MEMORY_HPP_ */
@@ -20,17 +20,21 @@ namespace tracer {
 
 	struct PhaseWorker {
 
-		void writeHeader(std::ostream& s, const Network::index_type index) const {
-			s << "# time\tphase[" << index << "]\n";
+		static const char* quantity() {
+			return "phase";
 		}
 
-		void trace(std::ostream& s, const Network& network, const Network::index_type index) const {
-			s << network.contact(index).phase;
+		double value(const Network& network, const Network::index_type index) const {
+			return network.phase(index);
 		}
 
 		static const char* fileNameFormat() {
 			return "phase.%u";
 		}
+
+		static const char* fileName() {
+			return "phase.dat";
+		}
 	};
 
 	class Phase : public IndexTracer<PhaseWorker> {
@@ -14,6 +14,7 @@
 #ifndef PHASE_DIFF_TRACER_HPP_
 #define PHASE_DIFF_TRACER_HPP_
 
+#include <sstream>
 #include <utility>
 #include <vector>
 
@@ -30,24 +31,22 @@ namespace tracer {
 			Base::doBeforeRun(network, startTime, endTime, dt);
 		}
 
-		virtual void doTrace(const Network& network, double const time, std::ostream& s) {
-			bool first = true;
-			for (IndexPairVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
-				s << network.contact(i->first).phase - network.contact(i->second).phase;
-				if (first) {
-					first = false;
-				} else {
-					s << '\t';
-				}
+		virtual void doTrace(const Network& network, double const time, std::vector<double>& values) {
+			for (std::size_t i = 0; i < indices.size(); ++i) {
+				values[i] = network.phase(indices[i].first) - network.phase(indices[i].second);
 			}
 		}
 
-		virtual void writeHeader(std::ostream& s) {
-			s << "# time";
+		virtual const char* getType() const {
+			return "phase-diff";
+		}
+
+		virtual void getColumns(std::vector<std::string>& columns) const {
 			for (IndexPairVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
-				s << "\tph" << i->first << "-ph" << i->second;
+				std::stringstream s;
+				s << "ph" << i->first << "-ph" << i->second;
+				columns.push_back(s.str());
 			}
-			s << '\n';
 		}
 
 	public:
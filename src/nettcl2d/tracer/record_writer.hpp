@@ -0,0 +1,327 @@
+/*
+ * tracer/record_writer.hpp --
+ *
+ * This file is part of nettcl2d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef TRACER_RECORD_WRITER_HPP_
+#define TRACER_RECORD_WRITER_HPP_
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <boost/scoped_ptr.hpp>
+#include <phlib/tracestream.h>
+#include "../calc/trace_file.hpp"
+#include "../calc/async_writer.hpp"
+#include "../calc/number_format.hpp"
+#include "../calc/xor_codec.hpp"
+
+namespace tracer {
+
+	/*
+	 * Writes trace records, a time and a value of every column each, as
+	 * lines of text or in the binary format described by TraceHeader.
+	 * Records are appended to an existing file, so repeated runs of a
+	 * tracer keep all of them; a header is written to a new or empty file
+	 * only. A binary file must have the same format, type and columns.
+	 * An open writer may be attached to an asynchronous writer, then
+	 * records are stored by its thread until the writer is closed.
+	 *
+	 * Text is formatted into a buffer written to the file in large blocks,
+	 * numbers look the same as std::fixed and std::scientific make them.
+	 * Compressed binary records are encoded in memory and written as a
+	 * block when the block grows large enough or the writer is closed.
+	 */
+	class RecordWriter : public AsyncWriter::Sink {
+
+		RecordWriter(const RecordWriter&);
+		RecordWriter& operator=(const RecordWriter&);
+
+	public:
+
+		enum Format {
+			FORMAT_TEXT,
+			FORMAT_FLOAT64,
+			FORMAT_FLOAT32,
+			FORMAT_XOR64,
+			FORMAT_XOR32
+		};
+
+		RecordWriter() :
+			numOfColumns(0),
+			timePrecision(2),
+			precision(6),
+			startTime(0.0),
+			interval(0.0),
+			valueSize(sizeof(double)),
+			async(NULL),
+			sink(0),
+			pending(0)
+		{}
+
+		virtual ~RecordWriter() {
+			close();
+		}
+
+		void setPrecision(int const timePrecision, int const precision) {
+			this->timePrecision = timePrecision;
+			this->precision = precision;
+		}
+
+		void setTimeBase(double const startTime, double const interval) {
+			this->startTime = startTime;
+			this->interval = interval;
+		}
+
+		/*
+		 * Opens a file for appending and writes a header describing the
+		 * columns if the file is empty. Returns false if the file cannot
+		 * be opened, throws TraceFile::FormatException if records cannot
+		 * be appended to an existing binary file.
+		 */
+		bool open(const std::string& fileName, Format const format, const std::string& type, const std::vector<std::string>& columns) {
+			close();
+			numOfColumns = columns.size();
+
+			if (FORMAT_TEXT == format) {
+				text.reset(new phlib::TraceStream(fileName));
+				if (!text->is_open()) {
+					close();
+				} else if (text->isHeaderRequired()) {
+					*text << "# time";
+					for (std::vector<std::string>::const_iterator i = columns.begin(), last = columns.end(); i != last; ++i) {
+						*text << '\t' << *i;
+					}
+					*text << '\n';
+				}
+			} else {
+				const bool compressed = FORMAT_XOR64 == format || FORMAT_XOR32 == format;
+				valueSize = FORMAT_FLOAT32 == format || FORMAT_XOR32 == format ? sizeof(float) : sizeof(double);
+				const bool append = prepareAppend(fileName, compressed, type, columns);
+
+				binary.reset(new std::ofstream(fileName.c_str(), std::ios::out | std::ios::app | std::ios::binary));
+				if (!binary->is_open()) {
+					close();
+				} else {
+					if (!append) {
+						writeHeader(compressed, type, columns);
+					}
+					record.resize(sizeof(double) + numOfColumns * valueSize);
+					if (compressed) {
+						encoder.reset(new xor_codec::Encoder(numOfColumns, valueSize));
+					}
+				}
+			}
+
+			return isOpen();
+		}
+
+		bool isOpen() const {
+			return text || binary;
+		}
+
+		void attach(AsyncWriter& writer) {
+			if (isOpen()) {
+				async = &writer;
+				sink = writer.attach(*this, numOfColumns);
+			}
+		}
+
+		void write(double const time, const double values[]) {
+			if (async) {
+				async->write(sink, time, values);
+			} else {
+				store(time, values);
+			}
+		}
+
+		virtual void store(double const time, const double values[]) {
+			if (text && !isFastText()) {
+				*text	<< std::fixed << std::setprecision(timePrecision) << time
+					<< std::scientific << std::setprecision(precision);
+				for (std::size_t i = 0; i < numOfColumns; ++i) {
+					*text << '\t' << values[i];
+				}
+				*text << '\n';
+			} else if (text) {
+				reserve();
+				char* p = &buffer[pending];
+				p = number_format::fixed(p, time, timePrecision);
+				pending = p - &buffer[0];
+
+				for (std::size_t i = 0; i < numOfColumns; ++i) {
+					reserve();
+					p = &buffer[pending];
+					*p++ = '\t';
+					p = number_format::scientific(p, values[i], precision);
+					pending = p - &buffer[0];
+				}
+
+				buffer[pending++] = '\n';
+			} else if (encoder) {
+				encoder->encode(time, values);
+				if (encoder->getSize() >= std::min(std::size_t(MAX_BLOCK_SIZE), std::max(std::size_t(MIN_BLOCK_SIZE), numOfColumns * 256))) {
+					writeBlock();
+				}
+			} else if (binary) {
+				char* p = &record[0];
+				std::memcpy(p, &time, sizeof(time));
+				p += sizeof(time);
+
+				if (sizeof(float) == valueSize) {
+					for (std::size_t i = 0; i < numOfColumns; ++i, p += sizeof(float)) {
+						const float v = values[i];
+						std::memcpy(p, &v, sizeof(v));
+					}
+				} else {
+					std::memcpy(p, values, numOfColumns * sizeof(double));
+				}
+
+				binary->write(&record[0], record.size());
+			}
+		}
+
+		void close() {
+			async = NULL;
+			flush();
+			writeBlock();
+			encoder.reset();
+			text.reset();
+			binary.reset();
+		}
+
+	private:
+
+		std::size_t numOfColumns;
+		int timePrecision;
+		int precision;
+		double startTime;
+		double interval;
+		std::size_t valueSize;
+		boost::scoped_ptr<phlib::TraceStream> text;
+		boost::scoped_ptr<std::ofstream> binary;
+		boost::scoped_ptr<xor_codec::Encoder> encoder;
+		std::vector<char> record;
+		AsyncWriter* async;
+		unsigned sink;
+
+		// formatted text not written yet
+		std::vector<char> buffer;
+		std::size_t pending;
+
+		// buffered text is written when less than a number fits, files of
+		// few columns get smaller buffers as there may be lots of them
+		static const std::size_t MIN_BUFFER_SIZE = 4096;
+		static const std::size_t MAX_BUFFER_SIZE = 65536;
+
+		// encoded bytes of a compressed block, a reader skips blocks
+		// before the records it needs without decoding them
+		static const std::size_t MIN_BLOCK_SIZE = 4096;
+		static const std::size_t MAX_BLOCK_SIZE = 1048576;
+
+		bool isFastText() const {
+			return timePrecision <= number_format::MAX_PRECISION && precision <= number_format::MAX_PRECISION;
+		}
+
+		void reserve() {
+			if (buffer.empty()) {
+				buffer.resize(std::min(std::size_t(MAX_BUFFER_SIZE), std::max(std::size_t(MIN_BUFFER_SIZE), (numOfColumns + 1) * 16 * number_format::MAX_LENGTH)));
+			}
+			if (pending + number_format::MAX_LENGTH + 2 > buffer.size()) {
+				flush();
+			}
+		}
+
+		void flush() {
+			if (text && pending > 0) {
+				text->write(&buffer[0], pending);
+			}
+			pending = 0;
+		}
+
+		void writeBlock() {
+			if (!encoder || 0 == encoder->getNumOfRecords()) {
+				return;
+			}
+
+			const std::vector<unsigned char>& bytes = encoder->finish();
+			const boost::uint32_t counts[2] = {
+				static_cast<boost::uint32_t>(encoder->getNumOfRecords()),
+				static_cast<boost::uint32_t>(bytes.size())
+			};
+			binary->write(reinterpret_cast<const char*>(counts), sizeof(counts));
+			binary->write(reinterpret_cast<const char*>(&bytes[0]), bytes.size());
+			encoder->reset();
+		}
+
+		/*
+		 * Checks that a nonempty file has the format and the columns of the
+		 * records to append and cuts off a record or a block left short by
+		 * an interrupted run. Returns false if there is no such file.
+		 */
+		bool prepareAppend(const std::string& fileName, bool const compressed, const std::string& type, const std::vector<std::string>& columns) const {
+			struct stat st;
+			if (0 != stat(fileName.c_str(), &st) || 0 == st.st_size) {
+				return false;
+			}
+
+			std::size_t dataEnd;
+			try {
+				const TraceFile file(fileName);
+				if (file.getValueSize() != valueSize || file.isCompressed() != compressed
+						|| file.getType() != type || file.getColumns() != columns) {
+					throw TraceFile::FormatException("");
+				}
+				dataEnd = file.getDataEnd();
+			} catch (TraceFile::FormatException&) {
+				throw TraceFile::FormatException("cannot append to " + fileName + ": not a trace file of the same format and columns");
+			}
+
+			if (dataEnd < static_cast<std::size_t>(st.st_size) && 0 != truncate(fileName.c_str(), dataEnd)) {
+				throw TraceFile::FormatException("cannot truncate " + fileName);
+			}
+			return true;
+		}
+
+		void writeHeader(bool const compressed, const std::string& type, const std::vector<std::string>& columns) {
+			std::string names(type.c_str(), type.size() + 1);
+			for (std::vector<std::string>::const_iterator i = columns.begin(), last = columns.end(); i != last; ++i) {
+				names.append(i->c_str(), i->size() + 1);
+			}
+			// records start at a multiple of eight bytes
+			names.resize((sizeof(TraceHeader) + names.size() + 7) / 8 * 8 - sizeof(TraceHeader), '\0');
+
+			TraceHeader header;
+			std::memcpy(header.magic, TraceHeader::signature(), sizeof(header.magic));
+			header.byteOrder = TraceHeader::BYTE_ORDER_MARK;
+			header.version = TraceHeader::CURRENT_VERSION;
+			header.valueSize = valueSize;
+			header.numOfColumns = numOfColumns;
+			header.encoding = compressed ? TraceHeader::ENCODING_XOR : TraceHeader::ENCODING_RAW;
+			header.reserved = 0;
+			header.dataOffset = sizeof(TraceHeader) + names.size();
+			header.startTime = startTime;
+			header.interval = interval;
+
+			binary->write(reinterpret_cast<const char*>(&header), sizeof(header));
+			binary->write(names.data(), names.size());
+		}
+
+	};
+
+}
+
+#endif /* TRACER_RECORD_WRITER_HPP_ */
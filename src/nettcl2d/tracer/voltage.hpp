@@ -20,17 +20,21 @@ namespace tracer {
 
 	struct VoltageWorker {
 
-		void writeHeader(std::ostream& s, const Network::index_type index) const {
-			s << "# time\tvoltage[" << index << "]\n";
+		static const char* quantity() {
+			return "voltage";
 		}
 
-		void trace(std::ostream& s, const Network& network, const Network::index_type index) const {
-			s << network.contact(index).voltage;
+		double value(const Network& network, const Network::index_type index) const {
+			return network.voltage(index);
 		}
 
 		static const char* fileNameFormat() {
 			return "u.%u";
 		}
+
+		static const char* fileName() {
+			return "u.dat";
+		}
 	};
 
 	class Voltage : public IndexTracer<VoltageWorker> {
@@ -99,6 +99,10 @@ proc nettcl2d::makeTracer { args } {
 		{tagExpr.arg	""		"Tag expression"}
 		{tagExpr1.arg	""		"Tag expression #1"}
 		{tagExpr2.arg	""		"Tag expression #2"}
+		{layout.arg	files		"Output layout of per-index tracers: files, columns or rows"}
+		{format.arg	text		"Output format: text, float64, float32, xor64 or xor32"}
+		{quantity.arg	voltage		"Quantity kept by memory tracer: voltage, flux, phase, avg-voltage or avg-flux"}
+		{capacity.arg	4096		"Number of records kept by memory tracer"}
 	}
 
 	set usage ": makeTracer \[options] type\noptions:"
@@ -117,6 +121,7 @@ proc nettcl2d::makeTracer { args } {
 	            $options(startTime)  \
 	            $options(precision)  \
 	            $options(tagExpr)  \
+	            $options(format)  \
             ]
         }
        
@@ -127,6 +132,8 @@ proc nettcl2d::makeTracer { args } {
 	            $options(startTime)  \
 	            $options(precision)  \
 	            $options(tagExpr)  \
+	            $options(layout)  \
+	            $options(format)  \
             ]
         }
        
@@ -137,6 +144,7 @@ proc nettcl2d::makeTracer { args } {
 	            $options(startTime)  \
 	            $options(precision)  \
 	            $options(tagExpr)  \
+	            $options(format)  \
             ]
         }
         
@@ -147,6 +155,8 @@ proc nettcl2d::makeTracer { args } {
 	            $options(startTime)  \
 	            $options(precision)  \
 	            $options(tagExpr)  \
+	            $options(layout)  \
+	            $options(format)  \
             ]
         }
         
@@ -157,6 +167,8 @@ proc nettcl2d::makeTracer { args } {
 	            $options(startTime)  \
 	            $options(precision)  \
 	            $options(tagExpr)  \
+	            $options(layout)  \
+	            $options(format)  \
             ]
         }
 
@@ -168,6 +180,17 @@ proc nettcl2d::makeTracer { args } {
 	            $options(precision)  \
 	            $options(tagExpr1)  \
 	            $options(tagExpr2)  \
+	            $options(format)  \
+            ]
+        }
+
+        memory {
+	        return [nettcl2d::tracer create memory \
+	            $options(quantity)  \
+	            $options(capacity)  \
+	            $options(interval)  \
+	            $options(startTime)  \
+	            $options(tagExpr)  \
             ]
         }
 
@@ -222,9 +245,7 @@ proc nettcl2d::single-circuit { network tagExpr { raiseError 1 } } {
 proc nettcl2d::setRandomContactProp { network propName tagExpr mean scattering { seed 12345 } } {
 	set rng [nettcl2d::rng create uniform $mean $scattering]
 	nettcl2d::rng seed $rng [expr { int($seed) }]
-	nettcl2d::foreachContact c $network $tagExpr {
-		nettcl2d::contact set $c $propName [nettcl2d::rng next $rng]
-	}
+	nettcl2d::network randomize $network $propName $tagExpr $rng
 }
 
 # Calculates summary flux in network
@@ -305,43 +326,5 @@ proc nettcl2d::write-xy-fluxes { network fileName { fileFormat map } } {
         set fileFormat map
     }
 
-    # determine dimensions
-    lassign [circuit-xy-dimensions $network] minx maxx miny maxy
-
-    set f [open $fileName w]
-    puts $f "# X\tY\tFlux"
-
-    for { set y $miny } { $y <= $maxy } { incr y } {
-
-        for { set x $minx } { $x <= $maxx } { incr x } {
-            set circuit [nettcl2d::single-circuit $network "x=$x & y=$y" 0]
-            if { ![nettcl2d::circuit exists $circuit] } {
-                set flux 0.0
-            } else {
-                set flux [nettcl2d::circuit get $circuit flux]
-            }
-
-            switch $fileFormat {
-                map {
-                    puts $f "$x\t$y\t$flux"
-                }
-                slices {
-                    puts $f "$x\t$y\t$flux"
-                    puts $f "$x\t$y\t0.0"
-                    puts $f ""
-                }
-            }
-        }
-
-        switch $fileFormat {
-            map {
-                puts $f ""
-            }
-            slices {
-                puts $f "\n"
-            }
-        }
-    }
-
-    close $f
+    nettcl2d::network flux-map $network $fileName $fileFormat
 }